@@ -10,6 +10,11 @@
  * 
  * Unlock Key: SEED_B (from PATHFINDER flag)
  * Flag: L3m0nCTF{chr0m4t1c_c0mpl3t3_d34db33f}
+ *
+ * TRILOGY_GRAPH=<graph_file> replaces the built-in edge list with a
+ * trilogy graph file keyed with the unlock key's XOR.
+ *
+ * Build: gcc -O2 -pthread -o chromatic chromatic.c
  */
 
 #include <stdio.h>
@@ -18,11 +23,24 @@
 #include <stdint.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../../common/trilogy_crypt.h"
+#include "../../common/trilogy_graph.h"
+#include "../../common/trilogy_parse.h"
+#include "../../common/trilogy_batch.h"
+#include "../../common/trilogy_serve.h"
 
 // ============== MAGIC MARKER ==============
-__attribute__((section(".magic")))
-__attribute__((aligned(4096)))
-static const char magic_marker[32] = "CHROMATIC_V2_FINAL_HARDENED_";
+#define MAGIC_TEXT "CHROMATIC_V2_FINAL_HARDENED_"
+_Static_assert(TRILOGY_MAGIC_FITS(MAGIC_TEXT), "magic marker too long");
+TRILOGY_MAGIC static const char magic_marker[TRILOGY_MAGIC_LEN] = MAGIC_TEXT;
+
+// Bounds of the marker section, provided by the linker
+extern const char __start_trilogy_magic[], __stop_trilogy_magic[];
 
 // ============== CONFIGURATION ==============
 #define NUM_NODES 16
@@ -38,47 +56,27 @@ static const uint8_t obf_unlock[] = {0x40, 0x56, 0x56, 0x57, 0x4c, 0x51, 0x00};
 // Color 1: {1, 3, 6, 9, 12}
 // Color 2: {2, 5, 8, 11, 14}
 // Edges only connect different colors
-// XOR encrypted with key 0x0A (derived from SEED_B)
+// XOR encrypted by the compiler with key 0x0A (derived from SEED_B)
+#define CHROMATIC_EDGE_KEY 0x0A
+#define CHROMATIC_EDGES(X) \
+    X(0, 11) X(1, 10) X(1, 11) \
+    X(2, 3) X(2, 4) X(2, 7) X(2, 9) \
+    X(3, 5) X(3, 7) X(3, 8) X(3, 10) X(3, 14) X(3, 15) \
+    X(4, 12) X(5, 9) X(5, 13) X(6, 8) X(6, 14) X(7, 12) \
+    X(8, 13) X(8, 15) X(9, 11) X(9, 14) X(11, 12) X(12, 14) X(13, 14)
 
+#define ENCRYPT_EDGE(u, v) { TRILOGY_XOR8(u, CHROMATIC_EDGE_KEY), TRILOGY_XOR8(v, CHROMATIC_EDGE_KEY) },
 __attribute__((section(".edges")))
-static const uint8_t encrypted_edges[][2] = {
-    {0x0A, 0x01}, // 0-11
-    {0x0B, 0x00}, // 1-10
-    {0x0B, 0x01}, // 1-11
-    {0x08, 0x09}, // 2-3
-    {0x08, 0x0E}, // 2-4
-    {0x08, 0x0D}, // 2-7
-    {0x08, 0x03}, // 2-9
-    {0x09, 0x0F}, // 3-5
-    {0x09, 0x0D}, // 3-7
-    {0x09, 0x02}, // 3-8
-    {0x09, 0x00}, // 3-10
-    {0x09, 0x04}, // 3-14
-    {0x09, 0x05}, // 3-15
-    {0x0E, 0x06}, // 4-12
-    {0x0F, 0x03}, // 5-9
-    {0x0F, 0x07}, // 5-13
-    {0x0C, 0x02}, // 6-8
-    {0x0C, 0x04}, // 6-14
-    {0x0D, 0x06}, // 7-12
-    {0x02, 0x07}, // 8-13
-    {0x02, 0x05}, // 8-15
-    {0x03, 0x01}, // 9-11
-    {0x03, 0x04}, // 9-14
-    {0x01, 0x06}, // 11-12
-    {0x06, 0x04}, // 12-14
-    {0x07, 0x04}, // 13-14
-    
-    // Terminator
-    {0xFF, 0xFF}
-};
+static const uint8_t encrypted_edges[][2] = { CHROMATIC_EDGES(ENCRYPT_EDGE) };
+#undef ENCRYPT_EDGE
 
-static int edges[64][2];
+#define NUM_EDGES ((int)(sizeof(encrypted_edges) / sizeof(encrypted_edges[0])))
+
+static int (*edges)[2];
 static int num_edges = 0;
+static int num_nodes = NUM_NODES;
 static int graph_decrypted = 0;
-
-// ============== UNLOCK STATE ==============
-static int is_unlocked = 0;
+static int chromatic_number = NUM_COLORS;  // recomputed at unlock
 
 // ============== RED HERRING ==============
 __attribute__((used))
@@ -105,87 +103,873 @@ static uint8_t derive_edge_key(const char* unlock) {
     return key;
 }
 
+// ============== EXACT CHROMATIC NUMBER ==============
+// Branch-and-bound over DSATUR orderings on bitset adjacency rows. A
+// greedy clique gives the lower bound and is pre-colored 0..q-1 (which
+// also breaks color symmetry); a greedy DSATUR pass gives the upper bound
+// and a fallback witness. Between the two, k = q, q+1, ... is tried in
+// turn with a k-color budget: the first k that yields a coloring is the
+// chromatic number. Tight budgets fail fast, so refuting small k is far
+// cheaper than descending from the greedy bound on sparse graphs.
+// Neighbour color counts make saturation updates O(degree).
+#define ROW_WORDS(n) (((n) + 63) / 64)
+
+struct chi_graph {
+    int32_t n;
+    size_t words;
+    uint64_t* adj;      // n rows of words bits
+    int32_t* degree;
+};
+
+struct chi_solver {
+    const struct chi_graph* g;
+    int32_t* color;     // -1 while uncolored
+    int32_t* best;      // witness for ub
+    int32_t* count;     // n x cap neighbour color counts
+    int32_t* sat;       // distinct neighbour colors
+    int32_t* free_deg;  // uncolored neighbours
+    int32_t cap;
+    int32_t lb, ub;
+    uint64_t nodes, limit;  // limit 0 = no limit
+    int aborted;
+};
+
+static inline int bitset_test(const uint64_t* set, size_t i) {
+    return (int)((set[i >> 6] >> (i & 63)) & 1);
+}
+
+static inline void bitset_set(uint64_t* set, size_t i) {
+    set[i >> 6] |= 1ULL << (i & 63);
+}
+
+static void chi_graph_free(struct chi_graph* g) {
+    free(g->adj);
+    free(g->degree);
+    memset(g, 0, sizeof(*g));
+}
+
+// Self-loops and duplicate edges are dropped
+static int chi_graph_init(struct chi_graph* g, int32_t n) {
+    g->n = n;
+    g->words = ROW_WORDS(n > 0 ? n : 1);
+    g->adj = calloc((size_t)(n > 0 ? n : 1) * g->words, sizeof(uint64_t));
+    g->degree = calloc((size_t)(n > 0 ? n : 1), sizeof(int32_t));
+    if (!g->adj || !g->degree) {
+        chi_graph_free(g);
+        return -1;
+    }
+    return 0;
+}
+
+static void chi_add_edge(struct chi_graph* g, int32_t u, int32_t v) {
+    if (u == v || bitset_test(g->adj + (size_t)u * g->words, v)) return;
+    bitset_set(g->adj + (size_t)u * g->words, v);
+    bitset_set(g->adj + (size_t)v * g->words, u);
+    g->degree[u]++;
+    g->degree[v]++;
+}
+
+static void chi_assign(struct chi_solver* s, int32_t v, int32_t c) {
+    const struct chi_graph* g = s->g;
+    const uint64_t* row = g->adj + (size_t)v * g->words;
+    s->color[v] = c;
+    for (size_t w = 0; w < g->words; w++) {
+        for (uint64_t bits = row[w]; bits; bits &= bits - 1) {
+            int32_t u = (int32_t)(w * 64 + __builtin_ctzll(bits));
+            if (s->count[(size_t)u * s->cap + c]++ == 0) s->sat[u]++;
+            s->free_deg[u]--;
+        }
+    }
+}
+
+static void chi_unassign(struct chi_solver* s, int32_t v) {
+    const struct chi_graph* g = s->g;
+    const uint64_t* row = g->adj + (size_t)v * g->words;
+    int32_t c = s->color[v];
+    s->color[v] = -1;
+    for (size_t w = 0; w < g->words; w++) {
+        for (uint64_t bits = row[w]; bits; bits &= bits - 1) {
+            int32_t u = (int32_t)(w * 64 + __builtin_ctzll(bits));
+            if (--s->count[(size_t)u * s->cap + c] == 0) s->sat[u]--;
+            s->free_deg[u]++;
+        }
+    }
+}
+
+// DSATUR choice: most distinct neighbour colors, then most uncolored
+// neighbours
+static int32_t chi_pick(const struct chi_solver* s) {
+    int32_t pick = -1;
+    for (int32_t v = 0; v < s->g->n; v++) {
+        if (s->color[v] >= 0) continue;
+        if (pick < 0 || s->sat[v] > s->sat[pick] ||
+            (s->sat[v] == s->sat[pick] && s->free_deg[v] > s->free_deg[pick])) {
+            pick = v;
+        }
+    }
+    return pick;
+}
+
+static void chi_search(struct chi_solver* s, int32_t colored, int32_t used) {
+    if (s->limit && ++s->nodes > s->limit) {
+        s->aborted = 1;
+        return;
+    }
+    if (colored == s->g->n) {
+        s->ub = used;
+        memcpy(s->best, s->color, (size_t)s->g->n * sizeof(int32_t));
+        return;
+    }
+    
+    int32_t v = chi_pick(s);
+    const int32_t* cnt = s->count + (size_t)v * s->cap;
+    for (int32_t c = 0; c < used; c++) {
+        if (cnt[c]) continue;
+        chi_assign(s, v, c);
+        chi_search(s, colored + 1, used);
+        chi_unassign(s, v);
+        if (s->ub <= s->lb || s->aborted || used >= s->ub) return;
+    }
+    // Opening a color only pays if it still beats the best coloring
+    if (used + 1 < s->ub) {
+        chi_assign(s, v, used);
+        chi_search(s, colored + 1, used + 1);
+        chi_unassign(s, v);
+    }
+}
+
+// Largest clique found by greedily growing from each vertex (highest
+// degree candidate first); returns its size and fills clique[]
+static int32_t greedy_clique(const struct chi_graph* g, int32_t* clique, uint64_t* cand) {
+    int32_t best = 0;
+    int32_t* cur = clique + g->n;
+    for (int32_t root = 0; root < g->n; root++) {
+        int32_t size = 0;
+        cur[size++] = root;
+        memcpy(cand, g->adj + (size_t)root * g->words, g->words * sizeof(uint64_t));
+        for (;;) {
+            int32_t next = -1;
+            for (size_t w = 0; w < g->words; w++) {
+                for (uint64_t bits = cand[w]; bits; bits &= bits - 1) {
+                    int32_t u = (int32_t)(w * 64 + __builtin_ctzll(bits));
+                    if (next < 0 || g->degree[u] > g->degree[next]) next = u;
+                }
+            }
+            if (next < 0) break;
+            cur[size++] = next;
+            const uint64_t* row = g->adj + (size_t)next * g->words;
+            for (size_t w = 0; w < g->words; w++) cand[w] &= row[w];
+        }
+        if (size > best) {
+            best = size;
+            memcpy(clique, cur, (size_t)size * sizeof(int32_t));
+        }
+    }
+    return best;
+}
+
+// Exact chromatic number with a witness coloring in colors[]. With a
+// node limit the search may stop early; *exact is then 0 and the result
+// is the best upper bound found. Returns -1 if out of memory.
+static int32_t solve_chromatic(const struct chi_graph* g, int32_t* colors, uint64_t limit,
+                               int* exact, int32_t* lower) {
+    struct chi_solver s = {0};
+    size_t n = (size_t)(g->n > 0 ? g->n : 1);
+    s.g = g;
+    s.limit = limit;
+    // DSATUR never needs more than max degree + 1 colors
+    for (int32_t v = 0; v < g->n; v++) {
+        if (g->degree[v] + 1 > s.cap) s.cap = g->degree[v] + 1;
+    }
+    if (s.cap == 0) s.cap = 1;
+    s.color = malloc(n * sizeof(int32_t));
+    s.best = colors;
+    s.sat = calloc(n, sizeof(int32_t));
+    s.free_deg = malloc(n * sizeof(int32_t));
+    s.count = calloc(n * (size_t)s.cap, sizeof(int32_t));
+    int32_t* clique = malloc(2 * n * sizeof(int32_t));
+    uint64_t* cand = malloc(g->words * sizeof(uint64_t));
+    if (!s.color || !s.sat || !s.free_deg || !s.count || !clique || !cand) {
+        free(s.color); free(s.sat); free(s.free_deg); free(s.count);
+        free(clique); free(cand);
+        return -1;
+    }
+    for (int32_t v = 0; v < g->n; v++) {
+        s.color[v] = -1;
+        s.free_deg[v] = g->degree[v];
+    }
+    
+    int32_t q = g->n > 0 ? greedy_clique(g, clique, cand) : 0;
+    s.lb = q;
+    
+    // Greedy DSATUR for the first upper bound
+    for (int32_t i = 0; i < g->n; i++) {
+        int32_t v = chi_pick(&s), c = 0;
+        while (s.count[(size_t)v * s.cap + c]) c++;
+        chi_assign(&s, v, c);
+        if (c + 1 > s.ub) s.ub = c + 1;
+    }
+    memcpy(colors, s.color, (size_t)g->n * sizeof(int32_t));
+    for (int32_t v = 0; v < g->n; v++) chi_unassign(&s, v);
+    
+    int32_t best = s.ub, proven = q;
+    for (int32_t k = q; k < best && !s.aborted; k++) {
+        // Success overwrites colors[] and drops ub to k
+        s.lb = k;
+        s.ub = k + 1;
+        for (int32_t i = 0; i < q; i++) chi_assign(&s, clique[i], i);
+        chi_search(&s, q, q);
+        for (int32_t i = q - 1; i >= 0; i--) chi_unassign(&s, clique[i]);
+        if (s.ub <= k) best = s.ub;
+        else if (!s.aborted) proven = k + 1;  // k refuted
+    }
+    
+    *exact = !s.aborted;
+    if (lower) *lower = proven;
+    free(s.color); free(s.sat); free(s.free_deg); free(s.count);
+    free(clique); free(cand);
+    return best;
+}
+
+// ============== PACKED COLORINGS ==============
+// Colorings are stored at the narrowest of 2, 4 or 8 bits per node that
+// holds k colors, lanes packed low-first into 64-bit words. Each width
+// gets its own get/set, edge-scan, count and hash kernels from one macro
+// (the lane count and mask are compile-time constants in each); the
+// dispatchers below pick the kernel set from the runtime width.
+struct packed_coloring {
+    uint32_t n;
+    uint32_t k;
+    int bits;
+    size_t words;
+    uint64_t* w;
+};
+
+#define DEFINE_PACKED_KERNELS(B)                                                        \
+static inline uint32_t packed_get_##B(const uint64_t* w, size_t i) {                   \
+    return (uint32_t)(w[i / (64 / B)] >> (i % (64 / B) * B)) & ((1u << B) - 1);         \
+}                                                                                       \
+                                                                                        \
+static inline void packed_set_##B(uint64_t* w, size_t i, uint32_t c) {                 \
+    unsigned shift = (unsigned)(i % (64 / B) * B);                                      \
+    uint64_t* p = &w[i / (64 / B)];                                                     \
+    *p = (*p & ~((uint64_t)((1u << B) - 1) << shift)) | (uint64_t)c << shift;           \
+}                                                                                       \
+                                                                                        \
+/* First conflicting edge in [begin, end), -1 if none; branch-free first pass */       \
+static int64_t packed_scan_##B(const uint32_t* e, size_t begin, size_t end,            \
+                               const uint64_t* w) {                                     \
+    unsigned bad = 0;                                                                   \
+    for (size_t j = begin; j < end; j++) {                                              \
+        bad |= packed_get_##B(w, e[2 * j]) == packed_get_##B(w, e[2 * j + 1]);          \
+    }                                                                                   \
+    if (!bad) return -1;                                                                \
+    for (size_t j = begin; j < end; j++) {                                              \
+        if (packed_get_##B(w, e[2 * j]) == packed_get_##B(w, e[2 * j + 1])) {           \
+            return (int64_t)j;                                                          \
+        }                                                                               \
+    }                                                                                   \
+    return -1;                                                                          \
+}                                                                                       \
+                                                                                        \
+static int64_t packed_count_##B(const uint32_t* e, size_t m, const uint64_t* w) {      \
+    int64_t conflicts = 0;                                                              \
+    for (size_t j = 0; j < m; j++) {                                                    \
+        conflicts += packed_get_##B(w, e[2 * j]) == packed_get_##B(w, e[2 * j + 1]);    \
+    }                                                                                   \
+    return conflicts;                                                                   \
+}                                                                                       \
+                                                                                        \
+/* FNV-1a over the colors in node order: same value as over an int array */           \
+static uint32_t packed_hash_##B(const uint64_t* w, size_t n) {                         \
+    uint32_t hash = 0x811c9dc5;                                                         \
+    for (size_t base = 0; base < n; base += 64 / B) {                                   \
+        uint64_t x = w[base / (64 / B)];                                                \
+        size_t lanes = n - base < 64 / B ? n - base : 64 / B;                           \
+        for (size_t l = 0; l < lanes; l++, x >>= B) {                                   \
+            hash ^= (uint32_t)(x & ((1u << B) - 1));                                    \
+            hash *= 0x01000193;                                                         \
+        }                                                                               \
+    }                                                                                   \
+    return hash;                                                                        \
+}
+
+DEFINE_PACKED_KERNELS(2)
+DEFINE_PACKED_KERNELS(4)
+DEFINE_PACKED_KERNELS(8)
+
+#define PACKED_MAX_COLORS 256
+
+static int packed_bits(uint32_t k) {
+    return k <= 4 ? 2 : k <= 16 ? 4 : 8;
+}
+
+static void packed_free(struct packed_coloring* p) {
+    free(p->w);
+    memset(p, 0, sizeof(*p));
+}
+
+// All nodes start at color 0; k <= PACKED_MAX_COLORS
+static int packed_init(struct packed_coloring* p, uint32_t n, uint32_t k) {
+    p->n = n;
+    p->k = k;
+    p->bits = packed_bits(k);
+    p->words = ((size_t)n * (size_t)p->bits + 63) / 64;
+    p->w = calloc(p->words ? p->words : 1, sizeof(uint64_t));
+    return p->w ? 0 : -1;
+}
+
+static inline uint32_t packed_get(const struct packed_coloring* p, size_t i) {
+    switch (p->bits) {
+    case 2: return packed_get_2(p->w, i);
+    case 4: return packed_get_4(p->w, i);
+    default: return packed_get_8(p->w, i);
+    }
+}
+
+static inline void packed_set(struct packed_coloring* p, size_t i, uint32_t c) {
+    switch (p->bits) {
+    case 2: packed_set_2(p->w, i, c); break;
+    case 4: packed_set_4(p->w, i, c); break;
+    default: packed_set_8(p->w, i, c); break;
+    }
+}
+
+static int64_t packed_scan(const struct packed_coloring* p, const uint32_t* e, size_t begin,
+                           size_t end) {
+    switch (p->bits) {
+    case 2: return packed_scan_2(e, begin, end, p->w);
+    case 4: return packed_scan_4(e, begin, end, p->w);
+    default: return packed_scan_8(e, begin, end, p->w);
+    }
+}
+
+static int64_t packed_count(const struct packed_coloring* p, const uint32_t* e, size_t m) {
+    switch (p->bits) {
+    case 2: return packed_count_2(e, m, p->w);
+    case 4: return packed_count_4(e, m, p->w);
+    default: return packed_count_8(e, m, p->w);
+    }
+}
+
+static uint32_t packed_hash(const struct packed_coloring* p) {
+    switch (p->bits) {
+    case 2: return packed_hash_2(p->w, p->n);
+    case 4: return packed_hash_4(p->w, p->n);
+    default: return packed_hash_8(p->w, p->n);
+    }
+}
+
+// Low bit of every non-zero lane of x set, all other bits clear: lanes
+// of two words that differ show up as set bits of lane_flags(a ^ b)
+static inline uint64_t lane_flags(uint64_t x, int bits) {
+    for (int s = 1; s < bits; s <<= 1) x |= x >> s;
+    return x & (bits == 2 ? 0x5555555555555555ULL
+              : bits == 4 ? 0x1111111111111111ULL : 0x0101010101010101ULL);
+}
+
+// ============== EDGE ORDERING ==============
+// Edge checks do two loads into the color array per edge. In input order
+// those land anywhere; sorted by the Hilbert index of the
+// (u / block, v / block) cell, consecutive edges stay inside two small
+// windows of the color array. One counting sort over a 1024 x 1024 cell
+// grid sets this up once per graph.
+#define HILBERT_BITS 10
+#define HILBERT_SIDE (1 << HILBERT_BITS)
+#define VERIFY_CHUNK 4096
+#define VERIFY_PARALLEL_MIN (1 << 16)
+
+struct edge_list {
+    uint32_t* e;        // (u, v) pairs with u < v, in Hilbert cell order
+    size_t m;
+    uint32_t n;
+    int shift;          // cell = vertex >> shift
+};
+
+static int online_cpus(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+}
+
+// CHROMATIC_THREADS overrides the online CPU count
+static int configured_threads(void) {
+    const char* t = getenv("CHROMATIC_THREADS");
+    int n = t ? atoi(t) : online_cpus();
+    return n < 1 ? 1 : n;
+}
+
+// Branch-free state machine (Hacker's Delight 16-8): two packed tables
+// give the next quadrant digit and orientation state per bit of x and y
+static uint32_t hilbert_index(uint32_t x, uint32_t y) {
+    uint32_t state = 0, d = 0;
+    for (int i = HILBERT_BITS - 1; i >= 0; i--) {
+        uint32_t row = 4 * state | 2 * ((x >> i) & 1) | ((y >> i) & 1);
+        d = (d << 2) | ((0x361E9CB4u >> 2 * row) & 3);
+        state = (0x8FE65831u >> 2 * row) & 3;
+    }
+    return d;
+}
+
+static void edge_list_free(struct edge_list* l) {
+    free(l->e);
+    memset(l, 0, sizeof(*l));
+}
+
+// pairs: m (u, v) pairs, every id < n. Self-loops are dropped.
+static int edge_list_build(struct edge_list* l, const uint32_t* pairs, size_t m, uint32_t n) {
+    memset(l, 0, sizeof(*l));
+    l->n = n;
+    while (((uint64_t)HILBERT_SIDE << l->shift) < n) l->shift++;
+    
+    // Cell of every edge, UINT32_MAX for self-loops. Cells are 20-bit, so
+    // two stable 10-bit counting passes sort them with cache-sized tables.
+    size_t low[HILBERT_SIDE + 1] = {0}, high[HILBERT_SIDE + 1] = {0};
+    uint32_t* cell = malloc((m ? m : 1) * sizeof(uint32_t));
+    if (!cell) return -1;
+    for (size_t i = 0; i < m; i++) {
+        uint32_t u = pairs[2 * i], v = pairs[2 * i + 1];
+        if (u > v) { uint32_t t = u; u = v; v = t; }
+        if (u == v) {
+            cell[i] = UINT32_MAX;
+            continue;
+        }
+        cell[i] = hilbert_index(u >> l->shift, v >> l->shift);
+        low[(cell[i] & (HILBERT_SIDE - 1)) + 1]++;
+        high[(cell[i] / HILBERT_SIDE) + 1]++;
+        l->m++;
+    }
+    for (int b = 0; b < HILBERT_SIDE; b++) {
+        low[b + 1] += low[b];
+        high[b + 1] += high[b];
+    }
+    
+    struct { uint32_t cell, u, v; }* tmp = malloc((l->m ? l->m : 1) * sizeof(*tmp));
+    l->e = malloc((l->m ? l->m : 1) * 2 * sizeof(uint32_t));
+    if (!tmp || !l->e) {
+        free(cell);
+        free(tmp);
+        edge_list_free(l);
+        return -1;
+    }
+    for (size_t i = 0; i < m; i++) {
+        if (cell[i] == UINT32_MAX) continue;
+        uint32_t u = pairs[2 * i], v = pairs[2 * i + 1];
+        size_t j = low[cell[i] & (HILBERT_SIDE - 1)]++;
+        tmp[j].cell = cell[i];
+        tmp[j].u = u < v ? u : v;
+        tmp[j].v = u < v ? v : u;
+    }
+    free(cell);
+    for (size_t i = 0; i < l->m; i++) {
+        size_t j = high[tmp[i].cell / HILBERT_SIDE]++;
+        l->e[2 * j] = tmp[i].u;
+        l->e[2 * j + 1] = tmp[i].v;
+    }
+    free(tmp);
+    return 0;
+}
+
+struct verify_ctx {
+    const struct edge_list* l;
+    const struct packed_coloring* colors;
+    size_t begin, end;
+    int64_t* conflict;  // shared, first conflicting edge found or -1
+    pthread_t thread;
+};
+
+// Scans whole chunks branch-free, then checks the shared flag so every
+// range stops soon after any thread finds a conflict
+static void* verify_range(void* arg) {
+    struct verify_ctx* c = arg;
+    for (size_t i = c->begin; i < c->end; i += VERIFY_CHUNK) {
+        if (__atomic_load_n(c->conflict, __ATOMIC_RELAXED) >= 0) break;
+        size_t end = i + VERIFY_CHUNK < c->end ? i + VERIFY_CHUNK : c->end;
+        int64_t j = packed_scan(c->colors, c->l->e, i, end);
+        if (j < 0) continue;
+        int64_t none = -1;
+        __atomic_compare_exchange_n(c->conflict, &none, j, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+        break;
+    }
+    return NULL;
+}
+
+// Index of a conflicting edge in l, or -1 if colors is proper on l
+static int64_t find_conflict(const struct edge_list* l, const struct packed_coloring* colors,
+                             int nthreads) {
+    int64_t conflict = -1;
+    if (l->m < VERIFY_PARALLEL_MIN) nthreads = 1;
+    struct verify_ctx one;
+    struct verify_ctx* c = nthreads > 1 ? calloc((size_t)nthreads, sizeof(*c)) : &one;
+    int* started = nthreads > 1 ? calloc((size_t)nthreads, sizeof(int)) : NULL;
+    if (!c || (nthreads > 1 && !started)) {
+        if (c != &one) free(c);
+        free(started);
+        c = &one;
+        started = NULL;
+        nthreads = 1;
+    }
+    
+    for (int t = 0; t < nthreads; t++) {
+        c[t].l = l;
+        c[t].colors = colors;
+        c[t].begin = l->m * (size_t)t / (size_t)nthreads;
+        c[t].end = l->m * (size_t)(t + 1) / (size_t)nthreads;
+        c[t].conflict = &conflict;
+    }
+    // The caller takes range 0, and any range whose thread did not start
+    for (int t = 1; t < nthreads; t++) {
+        started[t] = pthread_create(&c[t].thread, NULL, verify_range, &c[t]) == 0;
+    }
+    verify_range(&c[0]);
+    for (int t = 1; t < nthreads; t++) {
+        if (started[t]) pthread_join(c[t].thread, NULL);
+        else verify_range(&c[t]);
+    }
+    
+    free(started);
+    if (c != &one) free(c);
+    return conflict;
+}
+
+static struct edge_list checked_edges;
+
+// ============== INCREMENTAL RE-VERIFICATION ==============
+// Successive submissions usually differ in a handful of nodes. The last
+// coloring and its conflicting-edge count are kept, and a new coloring is
+// applied one changed node at a time: the node's incident edges drop the
+// conflicts of its old color and pick up those of its new one, so an
+// attempt costs O(changed degree). When the changed degree reaches the
+// edge count, a full recount is cheaper.
+// Node-to-edge incidence is fixed at unlock and shared read-only; the
+// last coloring and its conflict count belong to one session.
+struct coloring_graph {
+    int32_t n;
+    int64_t m;              // edges, self-loops included
+    int32_t* row_ptr;       // incident edges of v: nbr[row_ptr[v] .. row_ptr[v + 1])
+    int32_t* nbr;
+    int64_t self_loops;     // always in conflict, never in nbr[]
+};
+
+struct coloring_state {
+    const struct coloring_graph* g;
+    struct packed_coloring last;        // last coloring checked, all 0 initially
+    struct packed_coloring submitted;   // scratch for the next attempt
+    int64_t conflicts;      // conflicting edges under last
+    uint64_t rechecked;     // incident edges examined by the last check
+};
+
+static struct coloring_graph coloring_graph;
+
+static int coloring_graph_build(struct coloring_graph* cg, const int (*e)[2], int m, int32_t n) {
+    cg->n = n;
+    cg->m = m;
+    cg->row_ptr = calloc((size_t)n + 1, sizeof(int32_t));
+    cg->nbr = malloc((size_t)(2 * m + 1) * sizeof(int32_t));
+    if (!cg->row_ptr || !cg->nbr) {
+        return -1;
+    }
+    
+    for (int i = 0; i < m; i++) {
+        if (e[i][0] == e[i][1]) {
+            cg->self_loops++;
+            continue;
+        }
+        cg->row_ptr[e[i][0] + 1]++;
+        cg->row_ptr[e[i][1] + 1]++;
+    }
+    for (int32_t v = 0; v < n; v++) cg->row_ptr[v + 1] += cg->row_ptr[v];
+    int32_t* fill = malloc((size_t)(n ? n : 1) * sizeof(int32_t));
+    if (!fill) return -1;
+    memcpy(fill, cg->row_ptr, (size_t)n * sizeof(int32_t));
+    for (int i = 0; i < m; i++) {
+        if (e[i][0] == e[i][1]) continue;
+        cg->nbr[fill[e[i][0]]++] = e[i][1];
+        cg->nbr[fill[e[i][1]]++] = e[i][0];
+    }
+    free(fill);
+    return 0;
+}
+
+static int coloring_state_init(struct coloring_state* cs, const struct coloring_graph* g, uint32_t k) {
+    memset(cs, 0, sizeof(*cs));
+    cs->g = g;
+    if (packed_init(&cs->last, (uint32_t)g->n, k) < 0 ||
+        packed_init(&cs->submitted, (uint32_t)g->n, k) < 0) {
+        packed_free(&cs->last);
+        return -1;
+    }
+    
+    // Everything starts as color 0, so every edge conflicts
+    cs->conflicts = g->m;
+    return 0;
+}
+
+static void coloring_state_free(struct coloring_state* cs) {
+    packed_free(&cs->last);
+    packed_free(&cs->submitted);
+    memset(cs, 0, sizeof(*cs));
+}
+
+static void recolor_node(struct coloring_state* cs, int32_t v, uint32_t c) {
+    const struct coloring_graph* g = cs->g;
+    uint32_t old = packed_get(&cs->last, (size_t)v);
+    for (int32_t j = g->row_ptr[v]; j < g->row_ptr[v + 1]; j++) {
+        uint32_t cu = packed_get(&cs->last, (size_t)g->nbr[j]);
+        cs->conflicts += (cu == c) - (cu == old);
+    }
+    cs->rechecked += (uint64_t)(g->row_ptr[v + 1] - g->row_ptr[v]);
+    packed_set(&cs->last, (size_t)v, c);
+}
+
+// Moves the state to cs->submitted (already range-checked); returns the
+// new conflict count. Changed nodes are found a word at a time.
+static int64_t update_coloring(struct coloring_state* cs) {
+    const struct packed_coloring* next = &cs->submitted;
+    int bits = cs->last.bits;
+    size_t lanes = 64 / (size_t)bits;
+    int64_t changed_degree = 0;
+    for (size_t wi = 0; wi < cs->last.words; wi++) {
+        for (uint64_t f = lane_flags(cs->last.w[wi] ^ next->w[wi], bits); f; f &= f - 1) {
+            size_t v = wi * lanes + (size_t)__builtin_ctzll(f) / (size_t)bits;
+            changed_degree += cs->g->row_ptr[v + 1] - cs->g->row_ptr[v];
+        }
+    }
+    
+    cs->rechecked = 0;
+    if ((size_t)changed_degree >= checked_edges.m) {
+        memcpy(cs->last.w, next->w, cs->last.words * sizeof(uint64_t));
+        cs->conflicts = packed_count(&cs->last, checked_edges.e, checked_edges.m) + cs->g->self_loops;
+        cs->rechecked = checked_edges.m;
+        return cs->conflicts;
+    }
+    for (size_t wi = 0; wi < cs->last.words; wi++) {
+        // Recoloring a node only rewrites its own lane, so f stays valid
+        for (uint64_t f = lane_flags(cs->last.w[wi] ^ next->w[wi], bits); f; f &= f - 1) {
+            size_t v = wi * lanes + (size_t)__builtin_ctzll(f) / (size_t)bits;
+            recolor_node(cs, (int32_t)v, packed_get(next, v));
+        }
+    }
+    return cs->conflicts;
+}
+
+// ============== HASH INDEX ==============
+// Hash answers are FNV-1a over the coloring relabeled in first-occurrence
+// order, so all k! color permutations of a coloring share one hash. The
+// hash of the reference coloring (the solver's, for graph files) is
+// indexed once at unlock.
+#define HASH_INDEX_MAX 4
+
+// Scrambled: Color 0: {0,4,7,10,13,15}, Color 1: {1,3,6,9,12}, Color 2: {2,5,8,11,14}
+static const uint8_t reference_coloring[NUM_NODES] = {0,1,2,1,0,2,1,0,2,1,0,2,1,0,2,0};
+
+static uint32_t hash_index[HASH_INDEX_MAX];
+static int hash_index_size = 0;
+
+static uint32_t hash_coloring(const struct packed_coloring* colors) {
+    struct packed_coloring canon;
+    uint16_t label[256];
+    uint32_t next = 0;
+    if (packed_init(&canon, colors->n, colors->k) < 0) return 0;
+    memset(label, 0xff, sizeof(label));
+    for (size_t i = 0; i < colors->n; i++) {
+        uint32_t c = packed_get(colors, i);
+        if (label[c] == 0xffff) label[c] = (uint16_t)next++;
+        packed_set(&canon, i, label[c]);
+    }
+    uint32_t hash = packed_hash(&canon);
+    packed_free(&canon);
+    return hash;
+}
+
+static void index_coloring(const struct packed_coloring* colors) {
+    uint32_t hash = hash_coloring(colors);
+    for (int i = 0; i < hash_index_size; i++) {
+        if (hash_index[i] == hash) return;
+    }
+    if (hash_index_size < HASH_INDEX_MAX) hash_index[hash_index_size++] = hash;
+}
+
+static int hash_indexed(uint32_t hash) {
+    for (int i = 0; i < hash_index_size; i++) {
+        if (hash_index[i] == hash) return 1;
+    }
+    return 0;
+}
+
 // ============== REAL: Decrypt edges ==============
+// Graph files beyond CHI_UNLOCK_MAX_NODES must carry their color budget;
+// smaller ones get the exact solver, cut off after CHI_UNLOCK_NODE_LIMIT
+// search nodes (the best coloring found so far sets the budget then).
+#define CHI_UNLOCK_MAX_NODES 4096
+#define CHI_UNLOCK_NODE_LIMIT (1ULL << 24)
+
+// Edge list (u <= v) from a trilogy graph file instead of the built-in table
+static void load_graph_file(const char* path, uint8_t key) {
+    struct trilogy_graph f;
+    int rc = trilogy_graph_open(path, key, &f);
+    if (rc < 0) {
+        fprintf(stderr, "Cannot load graph %s: %s.\n", path, trilogy_graph_strerror(rc));
+        exit(1);
+    }
+    int64_t count = 0;
+    for (int32_t u = 0; u < f.n; u++) {
+        for (int64_t k = f.row_ptr[u]; k < f.row_ptr[u + 1]; k++) count += u <= f.col[k];
+    }
+    if (count > INT32_MAX / 2 || f.colors > PACKED_MAX_COLORS ||
+        (!f.colors && f.n > CHI_UNLOCK_MAX_NODES)) {
+        fprintf(stderr, "Graph %s is too large or has no color budget.\n", path);
+        exit(1);
+    }
+    edges = malloc((size_t)(count ? count : 1) * sizeof(*edges));
+    if (!edges) {
+        fprintf(stderr, "Out of memory.\n");
+        exit(1);
+    }
+    num_edges = 0;
+    for (int32_t u = 0; u < f.n; u++) {
+        for (int64_t k = f.row_ptr[u]; k < f.row_ptr[u + 1]; k++) {
+            if (u > f.col[k]) continue;
+            edges[num_edges][0] = u;
+            edges[num_edges][1] = f.col[k];
+            num_edges++;
+        }
+    }
+    num_nodes = f.n;
+    if (f.colors) chromatic_number = (int)f.colors;
+    trilogy_graph_close(&f);
+}
+
 static void decrypt_edges(const char* unlock) {
     if (graph_decrypted) return;
     
     uint8_t key = derive_edge_key(unlock);
-    num_edges = 0;
+    const char* path = getenv(TRILOGY_GRAPH_ENV);
+    int budget_fixed = 0;
+    if (path) {
+        chromatic_number = 0;
+        load_graph_file(path, key);
+        budget_fixed = chromatic_number > 0;
+    } else {
+        num_edges = NUM_EDGES;
+        edges = malloc((size_t)num_edges * sizeof(*edges));
+        if (!edges) {
+            fprintf(stderr, "Out of memory.\n");
+            exit(1);
+        }
+        for (int i = 0; i < num_edges; i++) {
+            edges[i][0] = encrypted_edges[i][0] ^ key;
+            edges[i][1] = encrypted_edges[i][1] ^ key;
+        }
+    }
+    
+    // The color budget is the graph's own chromatic number
+    struct chi_graph g;
+    int32_t* colors = budget_fixed ? NULL : malloc((size_t)num_nodes * sizeof(int32_t));
+    int exact, solved = 0;
+    if (colors && chi_graph_init(&g, num_nodes) == 0) {
+        for (int i = 0; i < num_edges; i++) chi_add_edge(&g, edges[i][0], edges[i][1]);
+        int32_t chi = solve_chromatic(&g, colors, path ? CHI_UNLOCK_NODE_LIMIT : 0, &exact, NULL);
+        if (chi > 0) {
+            chromatic_number = chi;
+            solved = 1;
+        }
+        chi_graph_free(&g);
+    }
+    if (chromatic_number <= 0 || chromatic_number > PACKED_MAX_COLORS) {
+        fprintf(stderr, "Cannot determine a color budget.\n");
+        exit(1);
+    }
     
-    for (int i = 0; encrypted_edges[i][0] != 0xFF; i++) {
-        edges[num_edges][0] = encrypted_edges[i][0] ^ key;
-        edges[num_edges][1] = encrypted_edges[i][1] ^ key;
-        num_edges++;
+    // int and uint32_t pairs share a layout, so the list is read in place
+    if (edge_list_build(&checked_edges, (const uint32_t*)&edges[0][0], (size_t)num_edges,
+                        (uint32_t)num_nodes) < 0 ||
+        coloring_graph_build(&coloring_graph, edges, num_edges, num_nodes) < 0) {
+        fprintf(stderr, "Out of memory.\n");
+        exit(1);
     }
     
+    // Index the reference coloring on the built-in graph; graph files have
+    // none, so the solver's own coloring stands in for it
+    struct packed_coloring known;
+    if (packed_init(&known, (uint32_t)num_nodes, (uint32_t)chromatic_number) == 0) {
+        if (!path) {
+            for (int i = 0; i < num_nodes; i++) packed_set(&known, (size_t)i, reference_coloring[i]);
+            index_coloring(&known);
+        } else if (solved) {
+            for (int i = 0; i < num_nodes; i++) packed_set(&known, (size_t)i, (uint32_t)colors[i]);
+            index_coloring(&known);
+        }
+        packed_free(&known);
+    }
+    free(colors);
+    
     graph_decrypted = 1;
 }
 
+// ============== SESSIONS ==============
+// Edges, incidence, color budget and hash index are written once by
+// decrypt_edges and only read afterwards, so any number of sessions share
+// them across threads. A session owns its incremental coloring state and
+// the answer that keys its flag.
+struct chromatic_session {
+    struct coloring_state coloring;
+    int unlocked;
+    char correct_answer[256];
+};
+
+// Requires decrypt_edges
+static int session_init(struct chromatic_session* s) {
+    memset(s, 0, sizeof(*s));
+    return coloring_state_init(&s->coloring, &coloring_graph, (uint32_t)chromatic_number);
+}
+
+static void session_free(struct chromatic_session* s) {
+    coloring_state_free(&s->coloring);
+    memset(s, 0, sizeof(*s));
+}
+
 // ============== VERIFY COLORING ==============
-static int verify_coloring(const int* colors) {
-    // Check all colors are valid
-    for (int i = 0; i < NUM_NODES; i++) {
-        if (colors[i] < 0 || colors[i] >= NUM_COLORS) {
-            return -1;
-        }
+// The comma-separated coloring is parsed straight into the packed
+// submission; the parser rejects colors outside the budget
+static int verify_coloring(struct coloring_state* cs, const char* input) {
+    struct packed_coloring* packed = &cs->submitted;
+    struct trilogy_list list;
+    int32_t color;
+    int count = 0, rc;
+    
+    // Check all colors are valid and every node gets exactly one
+    trilogy_list_init(&list, input, input + strlen(input), ',', (uint32_t)chromatic_number);
+    while ((rc = trilogy_list_next(&list, &color)) > 0 && count < num_nodes) {
+        packed_set(packed, (size_t)count++, (uint32_t)color);
+    }
+    if (rc != 0 || count != num_nodes) {
+        return -1;
     }
     
-    // Check no adjacent nodes have same color
-    for (int i = 0; i < num_edges; i++) {
-        int u = edges[i][0];
-        int v = edges[i][1];
-        if (colors[u] == colors[v]) {
-            return -2;
-        }
+    // Check no adjacent nodes have same color, re-checking only the
+    // edges at nodes that changed since the last attempt
+    if (update_coloring(cs) > 0) {
+        return -2;
     }
     
     return 1;
 }
 
-// ============== HASH COLORING ==============
-// Player must submit hash, not coloring itself
-static uint32_t hash_coloring(const int* colors) {
-    uint32_t hash = 0x811c9dc5;  // FNV-1a
-    for (int i = 0; i < NUM_NODES; i++) {
-        hash ^= (uint32_t)colors[i];
-        hash *= 0x01000193;
-    }
-    return hash;
-}
-
 // ============== PARSE AND VERIFY ==============
-static int check_answer(const char* input) {
+static int check_answer(struct chromatic_session* s, const char* input) {
     // Input format: hash value in hex (e.g., "a1b2c3d4")
     // OR coloring as comma-separated (e.g., "0,1,2,0,1,2...")
     
     // First try as coloring
     if (strchr(input, ',')) {
-        int colors[NUM_NODES];
-        char* copy = strdup(input);
-        char* tok = strtok(copy, ",");
-        int idx = 0;
-        
-        while (tok && idx < NUM_NODES) {
-            colors[idx++] = atoi(tok);
-            tok = strtok(NULL, ",");
-        }
-        free(copy);
-        
-        if (idx == NUM_NODES && verify_coloring(colors) == 1) {
-            return 1;
-        }
-        return 0;
+        return verify_coloring(&s->coloring, input) == 1;
     }
     
     // Try as hash
     unsigned int provided_hash;
     if (sscanf(input, "%x", &provided_hash) == 1) {
-        // Compute expected hash from valid coloring
-        // Scrambled: Color 0: {0,4,7,10,13,15}, Color 1: {1,3,6,9,12}, Color 2: {2,5,8,11,14}
-        int valid_colors[NUM_NODES] = {0,1,2,1,0,2,1,0,2,1,0,2,1,0,2,0};
-        
-        uint32_t expected = hash_coloring(valid_colors);
-        if (provided_hash == expected) {
+        // Canonical hashes of the valid colorings were indexed at unlock
+        if (hash_indexed(provided_hash)) {
             return 1;
         }
     }
@@ -195,19 +979,25 @@ static int check_answer(const char* input) {
 
 // ============== FLAG DERIVATION ==============
 // Key depends on BOTH magic bytes AND correct answer
-static char correct_answer[256] = {0};
+
+// Encrypted by the compiler: magic marker fold XOR answer (0x2F)
+#define FLAG_TEXT "L3m0nCTF{chr0m4t1c_c0mpl3t3_d34db33f}"
+#define FLAG_KEY (TRILOGY_FOLD_MAGIC(MAGIC_TEXT) ^ 0x2F)
+#define FLAG_LEN (sizeof(FLAG_TEXT) - 1)
+
+_Static_assert(TRILOGY_STRING_FITS(FLAG_TEXT), "flag too long");
+static const uint8_t encoded_flag[TRILOGY_STRING_MAX] = { TRILOGY_XOR_STRING(FLAG_TEXT, FLAG_KEY) };
+
+// Fold of the magic section, taken once at startup
+static uint8_t magic_key;
+
+static void init_magic_key(void) {
+    magic_key = trilogy_fold(__start_trilogy_magic,
+                             (size_t)(__stop_trilogy_magic - __start_trilogy_magic));
+}
 
 static uint8_t derive_flag_key(const char* answer) {
-    uint8_t buffer[32];
-    int fd = open("/proc/self/exe", O_RDONLY);
-    if (fd < 0) return 0x42;
-    lseek(fd, 0x3000, SEEK_SET);
-    read(fd, buffer, 32);
-    close(fd);
-    
-    // XOR magic bytes
-    uint8_t key = 0;
-    for (int i = 0; i < 32; i++) key ^= buffer[i];
+    uint8_t key = magic_key;
     
     // XOR with answer bytes - makes key answer-dependent!
     for (size_t i = 0; answer[i]; i++) {
@@ -218,31 +1008,25 @@ static uint8_t derive_flag_key(const char* answer) {
 }
 
 // ============== FLAG PRINTING ==============
-static void print_flag(void) {
-    // Flag: L3m0nCTF{chr0m4t1c_c0mpl3t3_d34db33f}
-    // XOR key = magic (0x40) XOR answer (0x2F) = 0x6F
-    unsigned char encoded_flag[] = {
-        0x23, 0x5c, 0x02, 0x5f, 0x01, 0x2c, 0x3b, 0x29,
-        0x14, 0x0c, 0x07, 0x1d, 0x5f, 0x02, 0x5b, 0x1b,
-        0x5e, 0x0c, 0x30, 0x0c, 0x5f, 0x02, 0x1f, 0x03,
-        0x5c, 0x1b, 0x5c, 0x30, 0x0b, 0x5c, 0x5b, 0x0b,
-        0x0d, 0x5c, 0x5c, 0x09, 0x12, 0x00
-    };
-    
-    uint8_t key = derive_flag_key(correct_answer);
+// FLAG_LEN bytes, decoded under the key the correct answer derives
+static void decode_flag(const char* answer, char* flag) {
+    // XOR key = magic_bytes XOR answer_bytes
+    trilogy_xor_into(flag, encoded_flag, FLAG_LEN, derive_flag_key(answer));
+}
+
+static void print_flag(const char* answer) {
+    char flag[FLAG_LEN];
+    decode_flag(answer, flag);
     
     printf("\n");
     printf("════════════════════════════════════════════════════\n");
     printf("        CHROMATIC CORE - CHALLENGE COMPLETE         \n");
     printf("════════════════════════════════════════════════════\n");
     printf(" You found a valid coloring for the hidden graph!   \n");
-    printf(" The chromatic number χ(G) = 3.                     \n");
+    printf(" The chromatic number χ(G) = %d.%*s\n", chromatic_number,
+           chromatic_number < 10 ? 21 : 20, "");
     printf("════════════════════════════════════════════════════\n");
-    printf(" FLAG: ");
-    for (size_t i = 0; encoded_flag[i]; i++) {
-        printf("%c", encoded_flag[i] ^ key);
-    }
-    printf("\n\n");
+    printf(" FLAG: %.*s\n\n", (int)FLAG_LEN, flag);
     printf(" CONGRATULATIONS! You have completed the trilogy!   \n");
     printf("════════════════════════════════════════════════════\n");
 }
@@ -272,7 +1056,7 @@ static void display_unlocked(void) {
     printf("║ Find it. Determine its chromatic number.           ║\n");
     printf("║ Provide a valid coloring.                          ║\n");
     printf("║                                                    ║\n");
-    printf("║ The graph has %d nodes.                            ║\n", NUM_NODES);
+    printf("║ The graph has %d nodes.                            ║\n", num_nodes);
     printf("╚════════════════════════════════════════════════════╝\n");
     printf("\n");
 }
@@ -287,8 +1071,658 @@ void debug_edges(void) {
     printf("\n");
 }
 
+// ============== EDGE FILES ==============
+// Little-endian uint32 (u, v) pairs, mapped read-only; the vertex count
+// is the highest id + 1. A plain trilogy graph file is accepted too: its
+// edges (u <= v) are copied out into owned.
+struct edge_file {
+    const uint32_t* e;
+    size_t m;
+    uint32_t n;
+    size_t bytes;
+    uint32_t* owned;
+};
+
+static int open_graph_edges(const char* path, struct edge_file* f) {
+    struct trilogy_graph g;
+    int rc = trilogy_graph_open(path, 0, &g);
+    if (rc < 0) {
+        printf("Cannot load %s: %s.\n", path, trilogy_graph_strerror(rc));
+        return -1;
+    }
+    size_t m = 0;
+    for (int32_t u = 0; u < g.n; u++) {
+        for (int64_t k = g.row_ptr[u]; k < g.row_ptr[u + 1]; k++) m += u <= g.col[k];
+    }
+    uint32_t* e = malloc((m ? m : 1) * 2 * sizeof(uint32_t));
+    if (!e || (uint32_t)g.n > INT32_MAX / 2) {
+        printf(e ? "Too many vertices.\n" : "Out of memory.\n");
+        free(e);
+        trilogy_graph_close(&g);
+        return -1;
+    }
+    size_t i = 0;
+    for (int32_t u = 0; u < g.n; u++) {
+        for (int64_t k = g.row_ptr[u]; k < g.row_ptr[u + 1]; k++) {
+            if (u > g.col[k]) continue;
+            e[2 * i] = (uint32_t)u;
+            e[2 * i + 1] = (uint32_t)g.col[k];
+            i++;
+        }
+    }
+    f->e = f->owned = e;
+    f->m = m;
+    f->n = (uint32_t)g.n;
+    f->bytes = 0;
+    trilogy_graph_close(&g);
+    return 0;
+}
+
+static int open_edge_file(const char* path, struct edge_file* f) {
+    memset(f, 0, sizeof(*f));
+    if (trilogy_graph_sniff(path)) return open_graph_edges(path, f);
+    
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0 || st.st_size == 0 || st.st_size % 8 != 0) {
+        if (fd >= 0) close(fd);
+        printf("Edge file must be a non-empty sequence of uint32 pairs.\n");
+        return -1;
+    }
+    const uint32_t* e = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (e == MAP_FAILED) {
+        printf("Cannot map %s.\n", path);
+        return -1;
+    }
+    
+    f->e = e;
+    f->bytes = (size_t)st.st_size;
+    f->m = f->bytes / 8;
+    f->n = 0;
+    for (size_t i = 0; i < 2 * f->m; i++) {
+        if (e[i] >= f->n) f->n = e[i] + 1;
+    }
+    if (f->n > INT32_MAX / 2) {
+        printf("Too many vertices.\n");
+        munmap((void*)e, f->bytes);
+        return -1;
+    }
+    return 0;
+}
+
+static void close_edge_file(struct edge_file* f) {
+    if (f->owned) free(f->owned);
+    else if (f->e) munmap((void*)f->e, f->bytes);
+    f->e = f->owned = NULL;
+}
+
+// ============== TABUCOL LOCAL SEARCH ==============
+// Heuristic k-coloring for graphs far beyond the exact solver. Each
+// thread runs TabuCol independently from its own randomized greedy start:
+// gamma[v][c] counts v's neighbours colored c, so a move's conflict delta
+// is gamma[v][c] - gamma[v][color[v]] and applying it touches only v's
+// neighbours. Conflicted vertices live in an indexed list (O(1) insert and
+// remove); when there are many, a random sample of them is scanned per
+// move. A thread restarts after a long run without improvement, and the
+// first one to reach zero conflicts publishes its coloring and stops the
+// rest.
+#define TABU_SAMPLE 16
+#define TABU_MAX_COLORS 255
+
+struct nbr_graph {
+    int32_t n;
+    int64_t* row_ptr;
+    int32_t* col;
+};
+
+struct tabu_shared {
+    const struct nbr_graph* g;
+    int k;
+    struct timespec deadline;
+    int solved;             // atomic: set by the winning thread
+    uint8_t* result;
+    uint64_t iterations;    // atomic: summed over threads
+    uint64_t restarts;      // atomic
+};
+
+struct tabu_worker {
+    struct tabu_shared* sh;
+    pthread_t thread;
+    uint64_t rng;
+    uint8_t* color;
+    int32_t* gamma;         // n x k
+    uint32_t* tabu;         // n x k, iteration a move becomes legal again
+    int32_t* conflicted;
+    int32_t* pos;           // index in conflicted[], -1 if not conflicted
+    int32_t num_conflicted;
+    int64_t conflicts;      // conflicting edges
+};
+
+static void nbr_graph_free(struct nbr_graph* g) {
+    free(g->row_ptr);
+    free(g->col);
+    memset(g, 0, sizeof(*g));
+}
+
+// Both directions of every edge, self-loops dropped
+static int nbr_graph_build(struct nbr_graph* g, const struct edge_file* f) {
+    g->n = (int32_t)f->n;
+    g->row_ptr = calloc((size_t)g->n + 1, sizeof(int64_t));
+    if (!g->row_ptr) return -1;
+    for (size_t i = 0; i < f->m; i++) {
+        if (f->e[2 * i] == f->e[2 * i + 1]) continue;
+        g->row_ptr[f->e[2 * i] + 1]++;
+        g->row_ptr[f->e[2 * i + 1] + 1]++;
+    }
+    for (int32_t v = 0; v < g->n; v++) g->row_ptr[v + 1] += g->row_ptr[v];
+    
+    g->col = malloc((size_t)(g->row_ptr[g->n] ? g->row_ptr[g->n] : 1) * sizeof(int32_t));
+    int64_t* fill = malloc((size_t)(g->n ? g->n : 1) * sizeof(int64_t));
+    if (!g->col || !fill) {
+        free(fill);
+        nbr_graph_free(g);
+        return -1;
+    }
+    memcpy(fill, g->row_ptr, (size_t)g->n * sizeof(int64_t));
+    for (size_t i = 0; i < f->m; i++) {
+        uint32_t u = f->e[2 * i], v = f->e[2 * i + 1];
+        if (u == v) continue;
+        g->col[fill[u]++] = (int32_t)v;
+        g->col[fill[v]++] = (int32_t)u;
+    }
+    free(fill);
+    return 0;
+}
+
+static inline uint64_t tabu_rand(struct tabu_worker* w) {
+    w->rng ^= w->rng << 13;
+    w->rng ^= w->rng >> 7;
+    w->rng ^= w->rng << 17;
+    return w->rng;
+}
+
+static inline void tabu_mark(struct tabu_worker* w, int32_t v) {
+    int k = w->sh->k;
+    int in = w->gamma[(size_t)v * k + w->color[v]] > 0;
+    if (in && w->pos[v] < 0) {
+        w->pos[v] = w->num_conflicted;
+        w->conflicted[w->num_conflicted++] = v;
+    } else if (!in && w->pos[v] >= 0) {
+        int32_t last = w->conflicted[--w->num_conflicted];
+        w->conflicted[w->pos[v]] = last;
+        w->pos[last] = w->pos[v];
+        w->pos[v] = -1;
+    }
+}
+
+// Greedy start over a random vertex order: the color with the fewest
+// already-colored neighbours, lowest such color first
+static void tabu_restart(struct tabu_worker* w, int32_t* order) {
+    const struct nbr_graph* g = w->sh->g;
+    int k = w->sh->k;
+    for (int32_t v = 0; v < g->n; v++) order[v] = v;
+    for (int32_t i = g->n - 1; i > 0; i--) {
+        int32_t j = (int32_t)(tabu_rand(w) % (uint64_t)(i + 1));
+        int32_t t = order[i]; order[i] = order[j]; order[j] = t;
+    }
+    memset(w->gamma, 0, (size_t)g->n * k * sizeof(int32_t));
+    memset(w->tabu, 0, (size_t)g->n * k * sizeof(uint32_t));
+    for (int32_t v = 0; v < g->n; v++) w->pos[v] = -1;
+    w->num_conflicted = 0;
+    w->conflicts = 0;
+    
+    // gamma doubles as the running neighbour-color count during the pass
+    for (int32_t i = 0; i < g->n; i++) {
+        int32_t v = order[i];
+        const int32_t* gv = w->gamma + (size_t)v * k;
+        int best = 0;
+        for (int c = 1; c < k; c++) {
+            if (gv[c] < gv[best]) best = c;
+        }
+        w->color[v] = (uint8_t)best;
+        w->conflicts += gv[best];
+        for (int64_t j = g->row_ptr[v]; j < g->row_ptr[v + 1]; j++) {
+            w->gamma[(size_t)g->col[j] * k + best]++;
+        }
+    }
+    for (int32_t v = 0; v < g->n; v++) tabu_mark(w, v);
+}
+
+static void tabu_move(struct tabu_worker* w, int32_t v, int c, uint64_t iter) {
+    const struct nbr_graph* g = w->sh->g;
+    int k = w->sh->k;
+    int old = w->color[v];
+    w->conflicts += w->gamma[(size_t)v * k + c] - w->gamma[(size_t)v * k + old];
+    w->color[v] = (uint8_t)c;
+    // Moving back is tabu for a tenure that grows with the conflict count
+    w->tabu[(size_t)v * k + old] = (uint32_t)(iter + w->num_conflicted * 6 / 10 +
+                                               tabu_rand(w) % 10 + 1);
+    for (int64_t j = g->row_ptr[v]; j < g->row_ptr[v + 1]; j++) {
+        int32_t u = g->col[j];
+        w->gamma[(size_t)u * k + old]--;
+        w->gamma[(size_t)u * k + c]++;
+        tabu_mark(w, u);
+    }
+    tabu_mark(w, v);
+}
+
+static void* tabu_thread(void* arg) {
+    struct tabu_worker* w = arg;
+    struct tabu_shared* sh = w->sh;
+    const struct nbr_graph* g = sh->g;
+    int k = sh->k;
+    int32_t* order = malloc((size_t)(g->n ? g->n : 1) * sizeof(int32_t));
+    if (!order) return NULL;
+    
+    uint64_t stall_limit = 100000 + 10 * (uint64_t)g->n;
+    uint64_t iter = 0, stall = 0;
+    int64_t best = INT64_MAX;
+    tabu_restart(w, order);
+    
+    while (w->conflicts > 0) {
+        if ((iter & 255) == 0) {
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            if (__atomic_load_n(&sh->solved, __ATOMIC_RELAXED) ||
+                now.tv_sec > sh->deadline.tv_sec ||
+                (now.tv_sec == sh->deadline.tv_sec && now.tv_nsec >= sh->deadline.tv_nsec)) {
+                break;
+            }
+        }
+        // uint32 tabu stamps: restart well before they could wrap
+        if (stall > stall_limit || iter > UINT32_MAX / 2) {
+            __atomic_add_fetch(&sh->iterations, iter, __ATOMIC_RELAXED);
+            __atomic_add_fetch(&sh->restarts, 1, __ATOMIC_RELAXED);
+            tabu_restart(w, order);
+            iter = stall = 0;
+            best = INT64_MAX;
+            continue;
+        }
+        iter++;
+        
+        // Best non-tabu move among (a sample of) the conflicted vertices;
+        // a tabu move is allowed when it beats the best seen (aspiration)
+        int32_t bv = -1;
+        int bc = 0;
+        int64_t bd = INT64_MAX;
+        uint32_t ties = 0;
+        int32_t scan = w->num_conflicted < TABU_SAMPLE ? w->num_conflicted : TABU_SAMPLE;
+        for (int32_t s = 0; s < scan; s++) {
+            int32_t v = scan == w->num_conflicted
+                ? w->conflicted[s]
+                : w->conflicted[tabu_rand(w) % (uint64_t)w->num_conflicted];
+            const int32_t* gv = w->gamma + (size_t)v * k;
+            const uint32_t* tv = w->tabu + (size_t)v * k;
+            int cv = w->color[v];
+            for (int c = 0; c < k; c++) {
+                if (c == cv) continue;
+                int64_t d = gv[c] - gv[cv];
+                if (tv[c] > iter && w->conflicts + d >= best) continue;
+                if (d < bd) {
+                    bd = d;
+                    bv = v;
+                    bc = c;
+                    ties = 1;
+                } else if (d == bd && tabu_rand(w) % ++ties == 0) {
+                    bv = v;
+                    bc = c;
+                }
+            }
+        }
+        if (bv < 0) {
+            bv = w->conflicted[tabu_rand(w) % (uint64_t)w->num_conflicted];
+            bc = (int)((w->color[bv] + 1 + tabu_rand(w) % (uint64_t)(k - 1)) % (uint64_t)k);
+        }
+        
+        tabu_move(w, bv, bc, iter);
+        if (w->conflicts < best) {
+            best = w->conflicts;
+            stall = 0;
+        } else {
+            stall++;
+        }
+    }
+    
+    __atomic_add_fetch(&sh->iterations, iter, __ATOMIC_RELAXED);
+    int expected = 0;
+    if (w->conflicts == 0 &&
+        __atomic_compare_exchange_n(&sh->solved, &expected, 1, 0, __ATOMIC_ACQ_REL,
+                                    __ATOMIC_RELAXED)) {
+        memcpy(sh->result, w->color, (size_t)g->n);
+    }
+    free(order);
+    return NULL;
+}
+
+// Returns 1 with a proper coloring in result[], 0 if the time ran out,
+// -1 if out of memory
+static int tabucol(const struct nbr_graph* g, int k, int nthreads, double seconds,
+                   uint8_t* result, uint64_t* iterations, uint64_t* restarts) {
+    struct tabu_shared sh = {0};
+    sh.g = g;
+    sh.k = k;
+    sh.result = result;
+    clock_gettime(CLOCK_MONOTONIC, &sh.deadline);
+    sh.deadline.tv_sec += (time_t)seconds;
+    sh.deadline.tv_nsec += (long)((seconds - (double)(time_t)seconds) * 1e9);
+    if (sh.deadline.tv_nsec >= 1000000000L) {
+        sh.deadline.tv_sec++;
+        sh.deadline.tv_nsec -= 1000000000L;
+    }
+    
+    struct tabu_worker* w = calloc((size_t)nthreads, sizeof(*w));
+    if (!w) return -1;
+    size_t n = (size_t)(g->n ? g->n : 1);
+    int started = 0, rc = 0;
+    for (int t = 0; t < nthreads; t++) {
+        w[t].sh = &sh;
+        w[t].rng = 0x9e3779b97f4a7c15ULL * (uint64_t)(t + 1) ^ (uint64_t)time(NULL);
+        if (!w[t].rng) w[t].rng = 1;
+        w[t].color = malloc(n);
+        w[t].gamma = malloc(n * (size_t)k * sizeof(int32_t));
+        w[t].tabu = malloc(n * (size_t)k * sizeof(uint32_t));
+        w[t].conflicted = malloc(n * sizeof(int32_t));
+        w[t].pos = malloc(n * sizeof(int32_t));
+        if (!w[t].color || !w[t].gamma || !w[t].tabu || !w[t].conflicted || !w[t].pos) {
+            rc = -1;
+            break;
+        }
+    }
+    for (int t = 0; t < nthreads && rc == 0; t++) {
+        if (pthread_create(&w[t].thread, NULL, tabu_thread, &w[t]) != 0) break;
+        started++;
+    }
+    for (int t = 0; t < started; t++) pthread_join(w[t].thread, NULL);
+    if (rc == 0 && started == 0) rc = -1;
+    
+    for (int t = 0; t < nthreads; t++) {
+        free(w[t].color);
+        free(w[t].gamma);
+        free(w[t].tabu);
+        free(w[t].conflicted);
+        free(w[t].pos);
+    }
+    free(w);
+    *iterations = sh.iterations;
+    *restarts = sh.restarts;
+    return rc < 0 ? -1 : sh.solved;
+}
+
+// ============== TABUCOL MODE ==============
+// chromatic --tabucol <edge_file> <k> [seconds [out_file]]: searches for
+// a k-coloring (k <= 255) with one TabuCol thread per core
+// (CHROMATIC_THREADS overrides) for up to the given time, default 60 s.
+// The coloring can be written out as one uint8 per vertex.
+static int run_tabucol_file(const char* path, int k, double seconds, const char* out_path) {
+    if (k < 2 || k > TABU_MAX_COLORS || seconds <= 0) {
+        printf("Need 2 <= k <= %d and a positive time limit.\n", TABU_MAX_COLORS);
+        return 1;
+    }
+    struct edge_file f;
+    if (open_edge_file(path, &f) < 0) return 1;
+    
+    struct nbr_graph g = {0};
+    uint8_t* colors = malloc(f.n ? f.n : 1);
+    if (!colors || nbr_graph_build(&g, &f) < 0) {
+        printf("Out of memory.\n");
+        free(colors);
+        close_edge_file(&f);
+        return 1;
+    }
+    
+    int nthreads = configured_threads();
+    struct timespec t0, t1;
+    uint64_t iterations = 0, restarts = 0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    int found = tabucol(&g, k, nthreads, seconds, colors, &iterations, &restarts);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    
+    int rc = 1;
+    printf("Vertices: %u  Edges: %zu  k: %d  Threads: %d\n", f.n, f.m, k, nthreads);
+    if (found < 0) {
+        printf("Out of memory.\n");
+    } else {
+        double ms = (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) / 1e6;
+        printf("Search: %.1f ms, %llu moves, %llu restarts\n", ms,
+               (unsigned long long)iterations, (unsigned long long)restarts);
+        if (!found) {
+            printf("No %d-coloring found within %.1f s.\n", k, seconds);
+        } else {
+            // Independent check against the raw edge list
+            size_t conflicts = 0;
+            for (size_t i = 0; i < f.m; i++) {
+                uint32_t u = f.e[2 * i], v = f.e[2 * i + 1];
+                conflicts += u != v && colors[u] == colors[v];
+            }
+            printf("Found %d-coloring: %s\n", k, conflicts ? "INVALID" : "valid");
+            rc = conflicts != 0;
+            
+            if (out_path && rc == 0) {
+                FILE* out = fopen(out_path, "wb");
+                if (!out || fwrite(colors, 1, f.n, out) != f.n) {
+                    printf("Cannot write %s.\n", out_path);
+                    rc = 1;
+                }
+                if (out && fclose(out) != 0) rc = 1;
+            }
+        }
+    }
+    
+    free(colors);
+    nbr_graph_free(&g);
+    close_edge_file(&f);
+    return rc;
+}
+
+// ============== VERIFY MODE ==============
+// chromatic --verify <edge_file> <coloring_file>: coloring file holds one
+// uint8 color per vertex (as written by --tabucol). Times the plain
+// input-order loop against the Hilbert-ordered multi-threaded check.
+static int run_verify_file(const char* edge_path, const char* coloring_path) {
+    struct edge_file f;
+    if (open_edge_file(edge_path, &f) < 0) return 1;
+    
+    int fd = open(coloring_path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0 || (uint64_t)st.st_size < f.n) {
+        if (fd >= 0) close(fd);
+        printf("Coloring file must hold one byte per vertex (%u).\n", f.n);
+        close_edge_file(&f);
+        return 1;
+    }
+    uint8_t* colors = malloc(f.n ? f.n : 1);
+    size_t got = 0;
+    while (colors && got < f.n) {
+        ssize_t r = read(fd, colors + got, f.n - got);
+        if (r <= 0) break;
+        got += (size_t)r;
+    }
+    close(fd);
+    if (!colors || got < f.n) {
+        printf("Cannot read %s.\n", coloring_path);
+        free(colors);
+        close_edge_file(&f);
+        return 1;
+    }
+    
+    // Pack at the narrowest width that holds the colors actually used
+    uint32_t k = 1;
+    for (size_t i = 0; i < f.n; i++) {
+        if (colors[i] >= k) k = (uint32_t)colors[i] + 1;
+    }
+    struct packed_coloring packed;
+    if (packed_init(&packed, f.n, k) < 0) {
+        printf("Out of memory.\n");
+        free(colors);
+        close_edge_file(&f);
+        return 1;
+    }
+    for (size_t i = 0; i < f.n; i++) packed_set(&packed, i, colors[i]);
+    
+    int nthreads = configured_threads();
+    struct edge_list l;
+    struct timespec t0, t1, t2, t3;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    if (edge_list_build(&l, f.e, f.m, f.n) < 0) {
+        printf("Out of memory.\n");
+        packed_free(&packed);
+        free(colors);
+        close_edge_file(&f);
+        return 1;
+    }
+    
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    size_t plain = SIZE_MAX;
+    for (size_t i = 0; i < f.m; i++) {
+        uint32_t u = f.e[2 * i], v = f.e[2 * i + 1];
+        if (u != v && colors[u] == colors[v]) {
+            plain = i;
+            break;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t2);
+    int64_t conflict = find_conflict(&l, &packed, nthreads);
+    clock_gettime(CLOCK_MONOTONIC, &t3);
+    
+    double sort_ms = (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) / 1e6;
+    double plain_ms = (t2.tv_sec - t1.tv_sec) * 1e3 + (t2.tv_nsec - t1.tv_nsec) / 1e6;
+    double fast_ms = (t3.tv_sec - t2.tv_sec) * 1e3 + (t3.tv_nsec - t2.tv_nsec) / 1e6;
+    printf("Vertices: %u  Edges: %zu  Threads: %d  Packing: %d bits/vertex\n", f.n, f.m,
+           nthreads, packed.bits);
+    printf("Reorder: %.1f ms (Hilbert cells of %u vertices)\n", sort_ms, 1u << l.shift);
+    if (conflict < 0) {
+        printf("Input order: %.1f ms, %.1f Medges/s (1 thread)\n", plain_ms,
+               plain_ms > 0 ? f.m / plain_ms / 1e3 : 0.0);
+        printf("Reordered:   %.1f ms, %.1f Medges/s\n", fast_ms,
+               fast_ms > 0 ? l.m / fast_ms / 1e3 : 0.0);
+    } else {
+        // Both scans stop early, so rates would mean nothing
+        printf("Input order: %.3f ms  Reordered: %.3f ms (stopped at first conflict)\n",
+               plain_ms, fast_ms);
+    }
+    if (conflict >= 0) {
+        uint32_t u = l.e[2 * conflict], v = l.e[2 * conflict + 1];
+        printf("Invalid: edge (%u, %u) has both ends colored %u.\n", u, v, colors[u]);
+    } else {
+        printf("Valid coloring.\n");
+    }
+    
+    int rc = (conflict >= 0) != (plain != SIZE_MAX) ? 2 : conflict >= 0;
+    if (rc == 2) printf("Input-order and reordered checks disagree.\n");
+    edge_list_free(&l);
+    packed_free(&packed);
+    free(colors);
+    close_edge_file(&f);
+    return rc;
+}
+
+// ============== CHI MODE ==============
+// chromatic --chi <edge_file> [node_limit]: edge file is little-endian
+// uint32 pairs (u, v); vertex count is the highest id + 1. Prints the
+// chromatic number (or bounds if the node limit is hit) and a witness
+// coloring.
+static int run_chi_file(const char* path, uint64_t limit) {
+    struct edge_file f;
+    if (open_edge_file(path, &f) < 0) return 1;
+    
+    struct chi_graph g;
+    int32_t* colors = NULL;
+    if (chi_graph_init(&g, (int32_t)f.n) < 0 || !(colors = malloc((size_t)f.n * sizeof(int32_t)))) {
+        printf("Out of memory.\n");
+        chi_graph_free(&g);
+        close_edge_file(&f);
+        return 1;
+    }
+    for (size_t i = 0; i < f.m; i++) chi_add_edge(&g, (int32_t)f.e[2 * i], (int32_t)f.e[2 * i + 1]);
+    
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    int exact;
+    int32_t lower;
+    int32_t chi = solve_chromatic(&g, colors, limit, &exact, &lower);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    
+    int rc = 0;
+    if (chi < 0) {
+        printf("Out of memory.\n");
+        rc = 1;
+    } else {
+        // Independent check of the witness against the raw edge list
+        size_t conflicts = 0;
+        for (size_t i = 0; i < f.m; i++) {
+            uint32_t u = f.e[2 * i], v = f.e[2 * i + 1];
+            conflicts += u != v && colors[u] == colors[v];
+        }
+        printf("Vertices: %u  Edges: %zu\n", f.n, f.m);
+        printf("Proven lower bound: %d\n", lower);
+        if (exact) printf("Chromatic number: %d\n", chi);
+        else printf("Chromatic number: between %d and %d (node limit reached)\n", lower, chi);
+        printf("Solve time: %.1f ms\n",
+               (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) / 1e6);
+        printf("Witness (%s):", conflicts ? "INVALID" : "valid");
+        for (uint32_t v = 0; v < f.n; v++) printf("%s%d", v ? "," : " ", colors[v]);
+        printf("\n");
+        rc = conflicts != 0;
+    }
+    
+    free(colors);
+    chi_graph_free(&g);
+    close_edge_file(&f);
+    return rc;
+}
+
+// ============== PIPE MODE ==============
+// chromatic <unlock_key> --pipe: one coloring or hash per line, one record
+// each: "ok <flag>" or "no"
+static void pipe_answer(void* ctx, struct trilogy_reply* r, char* line) {
+    struct chromatic_session* s = ctx;
+    if (!check_answer(s, line)) {
+        trilogy_reply_add(r, "no\n", 3);
+        return;
+    }
+    char flag[FLAG_LEN];
+    strncpy(s->correct_answer, line, 255);
+    decode_flag(s->correct_answer, flag);
+    trilogy_reply_add(r, "ok ", 3);
+    trilogy_reply_add(r, flag, FLAG_LEN);
+    trilogy_reply_add(r, "\n", 1);
+}
+
+// ============== SERVE MODE ==============
+// <unlock_key> --serve <port> [workers]: the --pipe protocol over TCP, one
+// session per connection (common/trilogy_serve.h)
+static int serve_open(void* ctx) {
+    struct chromatic_session* s = ctx;
+    if (session_init(s) < 0) return -1;
+    s->unlocked = 1;
+    return 0;
+}
+
+static void serve_close(void* ctx) {
+    session_free(ctx);
+}
+
+static const struct trilogy_service chromatic_service = {
+    sizeof(struct chromatic_session), serve_open, serve_close, pipe_answer
+};
+
 // ============== MAIN ==============
 int main(int argc, char** argv) {
+    init_magic_key();
+    if (argc >= 4 && strcmp(argv[1], "--tabucol") == 0) {
+        return run_tabucol_file(argv[2], atoi(argv[3]), argc >= 5 ? atof(argv[4]) : 60.0,
+                                argc >= 6 ? argv[5] : NULL);
+    }
+    
+    if (argc >= 4 && strcmp(argv[1], "--verify") == 0) {
+        return run_verify_file(argv[2], argv[3]);
+    }
+    
+    if (argc >= 3 && strcmp(argv[1], "--chi") == 0) {
+        return run_chi_file(argv[2], argc >= 4 ? strtoull(argv[3], NULL, 10) : 0);
+    }
+    
     if (argc < 2) {
         display_locked();
         printf("Usage: %s <unlock_key> [coloring]\n", argv[0]);
@@ -302,24 +1736,44 @@ int main(int argc, char** argv) {
     }
     
     decrypt_edges(argv[1]);
-    is_unlocked = 1;
+    
+    // Server mode: <unlock_key> --serve <port> [workers], a session per connection
+    if (argc >= 4 && strcmp(argv[2], "--serve") == 0) {
+        return trilogy_serve(atoi(argv[3]), argc >= 5 ? atoi(argv[4]) : 0, &chromatic_service) < 0;
+    }
+    
+    // Graph is shared from here on; the player gets a session
+    struct chromatic_session session;
+    if (session_init(&session) < 0) {
+        printf("Out of memory.\n");
+        return 1;
+    }
+    session.unlocked = 1;
+    int rc = 0;
+    
+    // Pipelined checker mode: <unlock_key> --pipe, one record per coloring
+    if (argc >= 3 && strcmp(argv[2], "--pipe") == 0) {
+        rc = trilogy_batch_run(STDIN_FILENO, STDOUT_FILENO, &session, pipe_answer) < 0;
+        session_free(&session);
+        return rc;
+    }
     
     if (argc >= 3) {
-        if (check_answer(argv[2])) {
-            strncpy(correct_answer, argv[2], 255);
-            display_unlocked();
-            print_flag();
-            return 0;
+        display_unlocked();
+        if (check_answer(&session, argv[2])) {
+            strncpy(session.correct_answer, argv[2], 255);
+            print_flag(session.correct_answer);
         } else {
-            display_unlocked();
             printf("Invalid coloring.\n");
-            return 1;
+            rc = 1;
         }
+        session_free(&session);
+        return rc;
     }
     
     display_unlocked();
     
-    printf("Enter coloring (comma-separated, %d values): ", NUM_NODES);
+    printf("Enter coloring (comma-separated, %d values): ", num_nodes);
     fflush(stdout);
     
     char input[256];
@@ -329,10 +1783,10 @@ int main(int argc, char** argv) {
         if (strcmp(input, "quit") == 0) break;
         
         if (strlen(input) > 0) {
-            if (check_answer(input)) {
-                strncpy(correct_answer, input, 255);
-                print_flag();
-                return 0;
+            if (check_answer(&session, input)) {
+                strncpy(session.correct_answer, input, 255);
+                print_flag(session.correct_answer);
+                break;
             } else {
                 printf("Invalid coloring.\n");
             }
@@ -342,5 +1796,6 @@ int main(int argc, char** argv) {
         fflush(stdout);
     }
     
+    session_free(&session);
     return 0;
 }
@@ -0,0 +1,190 @@
+/*
+ * Chromatic Trilogy pipelined answer protocol (--pipe)
+ *
+ * A checker writes any number of answers, one per line, in as few writes
+ * as it likes; every non-blank line gets exactly one result record back,
+ * in order. Records are short text lines ("ok <flag>", "no", ...) chosen
+ * by each binary. "quit" or end of input closes the session.
+ *
+ * Input is read in large blocks and split in place. The records for all
+ * complete lines of a block are appended to a chained reply buffer and
+ * sent with a single writev, so a batch of N answers costs one read and
+ * one write instead of N prompts, N fgets and N fflushes.
+ */
+
+#ifndef TRILOGY_BATCH_H
+#define TRILOGY_BATCH_H
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#ifndef TRILOGY_API
+#define TRILOGY_API static __attribute__((unused))
+#endif
+
+#define TRILOGY_REPLY_CHUNK (64 * 1024)
+#define TRILOGY_REPLY_CHUNKS 64             // flushed early past 4 MiB
+#define TRILOGY_BATCH_READ (64 * 1024)
+
+// Reply records in fixed chunks: chunks never move, so the iovecs stay
+// valid and a flush is one writev over the chunks in use
+struct trilogy_reply {
+    int fd;
+    int used;                               // chunks holding data
+    int allocated;
+    struct iovec iov[TRILOGY_REPLY_CHUNKS];
+};
+
+// Appends one record for a NUL-terminated answer line; ctx is the
+// caller's session
+typedef void (*trilogy_answer_fn)(void* ctx, struct trilogy_reply* r, char* line);
+
+TRILOGY_API void trilogy_reply_init(struct trilogy_reply* r, int fd) {
+    memset(r, 0, sizeof(*r));
+    r->fd = fd;
+}
+
+TRILOGY_API void trilogy_reply_free(struct trilogy_reply* r) {
+    for (int i = 0; i < r->allocated; i++) free(r->iov[i].iov_base);
+    memset(r, 0, sizeof(*r));
+}
+
+// Drops the pending records, keeping the chunks for reuse
+TRILOGY_API void trilogy_reply_reset(struct trilogy_reply* r) {
+    for (int i = 0; i < r->used; i++) r->iov[i].iov_len = 0;
+    r->used = 0;
+}
+
+// Sends everything pending with one writev (more only on partial writes)
+TRILOGY_API int trilogy_reply_flush(struct trilogy_reply* r) {
+    struct iovec iov[TRILOGY_REPLY_CHUNKS];
+    int n = r->used, first = 0;
+    memcpy(iov, r->iov, (size_t)n * sizeof(struct iovec));
+    while (first < n) {
+        ssize_t w = writev(r->fd, iov + first, n - first);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return -1;
+        while (first < n && (size_t)w >= iov[first].iov_len) {
+            w -= (ssize_t)iov[first++].iov_len;
+        }
+        if (first < n) {
+            iov[first].iov_base = (char*)iov[first].iov_base + w;
+            iov[first].iov_len -= (size_t)w;
+        }
+    }
+    trilogy_reply_reset(r);
+    return 0;
+}
+
+TRILOGY_API int trilogy_reply_add(struct trilogy_reply* r, const void* data, size_t len) {
+    const char* p = data;
+    while (len) {
+        struct iovec* cur = r->used ? &r->iov[r->used - 1] : NULL;
+        if (!cur || cur->iov_len == TRILOGY_REPLY_CHUNK) {
+            if (r->used == TRILOGY_REPLY_CHUNKS && trilogy_reply_flush(r) < 0) return -1;
+            if (r->used == r->allocated) {
+                void* chunk = malloc(TRILOGY_REPLY_CHUNK);
+                if (!chunk) return -1;
+                r->iov[r->allocated++] = (struct iovec){ chunk, 0 };
+            }
+            cur = &r->iov[r->used++];
+        }
+        size_t room = TRILOGY_REPLY_CHUNK - cur->iov_len;
+        size_t take = len < room ? len : room;
+        memcpy((char*)cur->iov_base + cur->iov_len, p, take);
+        cur->iov_len += take;
+        p += take;
+        len -= take;
+    }
+    return 0;
+}
+
+TRILOGY_API __attribute__((format(printf, 2, 3)))
+int trilogy_reply_printf(struct trilogy_reply* r, const char* fmt, ...) {
+    char line[256];
+    va_list ap;
+    va_start(ap, fmt);
+    int len = vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
+    if (len < 0) return -1;
+    return trilogy_reply_add(r, line, (size_t)len < sizeof(line) ? (size_t)len : sizeof(line) - 1);
+}
+
+// Answers the complete lines in buf[0 .. len), NUL-terminating each in
+// place, and returns the bytes consumed. Stops early at "quit" (setting
+// *quit) or once half the reply chunks are in use, so the caller can send
+// them before answering the rest.
+TRILOGY_API size_t trilogy_batch_lines(char* buf, size_t len, void* ctx, trilogy_answer_fn answer,
+                                       struct trilogy_reply* reply, int* quit) {
+    size_t start = 0;
+    char* nl;
+    while (reply->used < TRILOGY_REPLY_CHUNKS / 2 && (nl = memchr(buf + start, '\n', len - start))) {
+        char* line = buf + start;
+        start = (size_t)(nl - buf) + 1;
+        if (nl > line && nl[-1] == '\r') nl--;
+        *nl = '\0';
+        if (strcmp(line, "quit") == 0) {
+            *quit = 1;
+            break;
+        }
+        if (line[0]) answer(ctx, reply, line);
+    }
+    return start;
+}
+
+// Answers every line from fd in with answer(ctx, ...). Returns 0 at end of
+// input or "quit", -1 on a read, write or allocation failure.
+TRILOGY_API int trilogy_batch_run(int in, int out, void* ctx, trilogy_answer_fn answer) {
+    struct trilogy_reply reply;
+    size_t cap = TRILOGY_BATCH_READ, len = 0;
+    char* buf = malloc(cap + 1);
+    int rc = buf ? 1 : -1;
+    trilogy_reply_init(&reply, out);
+
+    while (rc > 0) {
+        // Long lines (file graphs) grow the buffer; nothing else allocates
+        if (len == cap) {
+            char* grown = realloc(buf, 2 * cap + 1);
+            if (!grown) {
+                rc = -1;
+                break;
+            }
+            buf = grown;
+            cap *= 2;
+        }
+        ssize_t got = read(in, buf + len, cap - len);
+        if (got < 0 && errno == EINTR) continue;
+        if (got < 0) {
+            rc = -1;
+            break;
+        }
+        if (got == 0) {
+            if (len == 0) break;
+            buf[len++] = '\n';      // last line without a newline
+            rc = 0;
+        } else {
+            len += (size_t)got;
+        }
+
+        size_t start = 0;
+        int quit = 0;
+        do {
+            start += trilogy_batch_lines(buf + start, len - start, ctx, answer, &reply, &quit);
+            if (trilogy_reply_flush(&reply) < 0) rc = -1;
+        } while (rc >= 0 && !quit && memchr(buf + start, '\n', len - start));
+        if (quit && rc > 0) rc = 0;
+        memmove(buf, buf + start, len - start);
+        len -= start;
+    }
+
+    trilogy_reply_free(&reply);
+    free(buf);
+    return rc;
+}
+
+#endif
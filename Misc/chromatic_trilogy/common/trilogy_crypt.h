@@ -0,0 +1,87 @@
+/*
+ * Chromatic Trilogy build-time encryption
+ *
+ * Tables and flags are authored in plaintext as macro arguments and XORed
+ * with their key by the compiler: only the encrypted bytes reach the
+ * binary, so neither `strings` nor a dump of .rodata shows the plaintext,
+ * and there is no plaintext copy to decode from at startup. The runtime
+ * side is one word-at-a-time XOR straight into the final layout.
+ */
+
+#ifndef TRILOGY_CRYPT_H
+#define TRILOGY_CRYPT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// One table entry XORed with a one-byte key
+#define TRILOGY_XOR8(x, key) ((uint8_t)((x) ^ (key)))
+
+// The key repeated over a 64-bit word, for bitset rows
+#define TRILOGY_KEY64(key) (0x0101010101010101ULL * (uint8_t)(key))
+
+// Byte i of string literal s XORed with key, 0 past its end
+#define TRILOGY_XOR_CHAR(s, i, key) \
+    ((size_t)(i) < sizeof(s) - 1 ? TRILOGY_XOR8((s)[(size_t)(i) < sizeof(s) - 1 ? (i) : 0], key) : 0)
+
+#define TRILOGY_XOR_CHARS8(s, i, key)                                          \
+    TRILOGY_XOR_CHAR(s, (i) + 0, key), TRILOGY_XOR_CHAR(s, (i) + 1, key),     \
+    TRILOGY_XOR_CHAR(s, (i) + 2, key), TRILOGY_XOR_CHAR(s, (i) + 3, key),     \
+    TRILOGY_XOR_CHAR(s, (i) + 4, key), TRILOGY_XOR_CHAR(s, (i) + 5, key),     \
+    TRILOGY_XOR_CHAR(s, (i) + 6, key), TRILOGY_XOR_CHAR(s, (i) + 7, key)
+
+// Initializer for a 64-byte array holding string literal s (at most 64
+// characters; check with TRILOGY_STRING_FITS) XORed with key
+#define TRILOGY_XOR_STRING(s, key)                                             \
+    TRILOGY_XOR_CHARS8(s, 0, key), TRILOGY_XOR_CHARS8(s, 8, key),             \
+    TRILOGY_XOR_CHARS8(s, 16, key), TRILOGY_XOR_CHARS8(s, 24, key),           \
+    TRILOGY_XOR_CHARS8(s, 32, key), TRILOGY_XOR_CHARS8(s, 40, key),           \
+    TRILOGY_XOR_CHARS8(s, 48, key), TRILOGY_XOR_CHARS8(s, 56, key)
+
+#define TRILOGY_STRING_MAX 64
+#define TRILOGY_STRING_FITS(s) (sizeof(s) - 1 <= TRILOGY_STRING_MAX)
+
+// Magic marker: each binary places one TRILOGY_MAGIC_LEN-byte marker in
+// section TRILOGY_MAGIC_SECTION. The name is a valid C identifier, so the
+// linker bounds it with __start_trilogy_magic and __stop_trilogy_magic and
+// the key is folded from the mapped image rather than read from the file.
+#define TRILOGY_MAGIC_SECTION "trilogy_magic"
+#define TRILOGY_MAGIC_LEN 32
+#define TRILOGY_MAGIC __attribute__((section(TRILOGY_MAGIC_SECTION), used, aligned(TRILOGY_MAGIC_LEN)))
+
+// XOR of the bytes of a marker literal, for encrypting against it
+#define TRILOGY_FOLD8(s, i)                                                    \
+    (TRILOGY_XOR_CHAR(s, (i) + 0, 0) ^ TRILOGY_XOR_CHAR(s, (i) + 1, 0) ^      \
+     TRILOGY_XOR_CHAR(s, (i) + 2, 0) ^ TRILOGY_XOR_CHAR(s, (i) + 3, 0) ^      \
+     TRILOGY_XOR_CHAR(s, (i) + 4, 0) ^ TRILOGY_XOR_CHAR(s, (i) + 5, 0) ^      \
+     TRILOGY_XOR_CHAR(s, (i) + 6, 0) ^ TRILOGY_XOR_CHAR(s, (i) + 7, 0))
+#define TRILOGY_FOLD_MAGIC(s)                                                  \
+    ((uint8_t)(TRILOGY_FOLD8(s, 0) ^ TRILOGY_FOLD8(s, 8) ^                     \
+               TRILOGY_FOLD8(s, 16) ^ TRILOGY_FOLD8(s, 24)))
+#define TRILOGY_MAGIC_FITS(s) (sizeof(s) - 1 <= TRILOGY_MAGIC_LEN)
+
+// XOR of n bytes at p
+static inline uint8_t trilogy_fold(const void* p, size_t n) {
+    const uint8_t* b = p;
+    uint8_t key = 0;
+    for (size_t i = 0; i < n; i++) key ^= b[i];
+    return key;
+}
+
+// dst = src ^ key over n bytes, eight bytes at a time; dst may equal src
+static inline void trilogy_xor_into(void* dst, const void* src, size_t n, uint8_t key) {
+    uint64_t k8 = TRILOGY_KEY64(key);
+    uint8_t* d = dst;
+    const uint8_t* s = src;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t w;
+        memcpy(&w, s + i, 8);
+        w ^= k8;
+        memcpy(d + i, &w, 8);
+    }
+    for (; i < n; i++) d[i] = s[i] ^ key;
+}
+
+#endif
@@ -0,0 +1,215 @@
+/*
+ * Chromatic Trilogy graph file - shared by VERTEX, PATHFINDER and
+ * CHROMATIC CORE
+ *
+ * A 64-byte header followed by a CSR adjacency, optional arc weights and
+ * an optional constraint block, all little-endian:
+ *
+ *   int64  row_ptr[n + 1]
+ *   int32  col[m]                   arcs of u: col[row_ptr[u] .. row_ptr[u+1]), sorted
+ *   int32  weight[m]                if TRILOGY_GRAPH_WEIGHTED
+ *   uint32 banned_nodes[nb]         \
+ *   uint32 banned_edges[2 * ne]      > if TRILOGY_GRAPH_CONSTRAINTS
+ *   uint32 waypoints[nw]            /
+ *
+ * Undirected graphs store both directions of every edge. Everything after
+ * the header is XORed with a one-byte key, the same key each binary
+ * derives for its built-in table (0 = plain). Files are mapped
+ * MAP_PRIVATE and decoded in place, so loading is one XOR pass plus a
+ * bounds check of the CSR; nothing is parsed or copied.
+ *
+ * Write files with trilogy_pack (common/trilogy_pack.c).
+ */
+
+#ifndef TRILOGY_GRAPH_H
+#define TRILOGY_GRAPH_H
+
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "trilogy_crypt.h"
+
+#define TRILOGY_GRAPH_MAGIC "TRIGRAPH"
+#define TRILOGY_GRAPH_VERSION 1
+#define TRILOGY_GRAPH_ENV "TRILOGY_GRAPH"  // replaces the built-in graph when set
+
+#define TRILOGY_GRAPH_WEIGHTED 0x1
+#define TRILOGY_GRAPH_CONSTRAINTS 0x2
+
+// Load errors
+#define TRILOGY_GRAPH_EIO -1        // cannot open or map
+#define TRILOGY_GRAPH_EFORMAT -2    // not a graph file of this version
+#define TRILOGY_GRAPH_EKEY -3       // CSR inconsistent: wrong key or corrupt
+
+#define TRILOGY_API static __attribute__((unused))
+
+struct trilogy_graph_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint32_t n;
+    uint32_t source;            // route endpoints (PATHFINDER)
+    uint32_t target;
+    uint32_t num_banned_nodes;
+    uint64_t m;                 // arcs
+    uint32_t num_banned_edges;
+    uint32_t num_waypoints;
+    uint32_t colors;            // color budget (CHROMATIC CORE), 0 = chromatic number
+    uint8_t reserved[12];
+};
+
+_Static_assert(sizeof(struct trilogy_graph_header) == 64, "graph header must be 64 bytes");
+
+struct trilogy_graph {
+    void* base;
+    size_t size;
+    int32_t n;
+    int64_t m;
+    int64_t* row_ptr;
+    int32_t* col;
+    int32_t* weight;            // NULL if unweighted
+    int32_t source;
+    int32_t target;
+    uint32_t colors;
+    const uint32_t* banned_nodes;
+    const uint32_t* banned_edges;   // (u, v) pairs
+    const uint32_t* waypoints;
+    uint32_t num_banned_nodes;
+    uint32_t num_banned_edges;
+    uint32_t num_waypoints;
+};
+
+// Payload encoding and decoding, in place
+TRILOGY_API void trilogy_graph_xor(void* data, size_t bytes, uint8_t key) {
+    if (key) trilogy_xor_into(data, data, bytes, key);
+}
+
+// Payload bytes implied by a header, 0 on overflow
+TRILOGY_API uint64_t trilogy_graph_payload(const struct trilogy_graph_header* h) {
+    if (h->n >= INT32_MAX || h->m > (uint64_t)INT64_MAX / 16) return 0;
+    uint64_t bytes = 8 * ((uint64_t)h->n + 1) + 4 * h->m;
+    if (h->flags & TRILOGY_GRAPH_WEIGHTED) bytes += 4 * h->m;
+    if (h->flags & TRILOGY_GRAPH_CONSTRAINTS) {
+        bytes += 4 * ((uint64_t)h->num_banned_nodes + 2 * (uint64_t)h->num_banned_edges +
+                      h->num_waypoints);
+    }
+    return bytes;
+}
+
+// 1 if path starts with the graph file magic
+TRILOGY_API int trilogy_graph_sniff(const char* path) {
+    char magic[8];
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    ssize_t got = read(fd, magic, sizeof(magic));
+    close(fd);
+    return got == (ssize_t)sizeof(magic) && memcmp(magic, TRILOGY_GRAPH_MAGIC, 8) == 0;
+}
+
+TRILOGY_API void trilogy_graph_close(struct trilogy_graph* g) {
+    if (g->base) munmap(g->base, g->size);
+    memset(g, 0, sizeof(*g));
+}
+
+// Rows must be sorted and in range, weights non-negative, and every
+// constraint must name an existing node
+static int trilogy_graph_check(const struct trilogy_graph* g) {
+    if (g->row_ptr[0] != 0 || g->row_ptr[g->n] != g->m) return -1;
+    for (int32_t u = 0; u < g->n; u++) {
+        int64_t begin = g->row_ptr[u], end = g->row_ptr[u + 1];
+        if (end < begin || end > g->m) return -1;
+        for (int64_t k = begin; k < end; k++) {
+            if ((uint32_t)g->col[k] >= (uint32_t)g->n) return -1;
+            if (k > begin && g->col[k] <= g->col[k - 1]) return -1;
+        }
+    }
+    for (int64_t k = 0; g->weight && k < g->m; k++) {
+        if (g->weight[k] < 0) return -1;
+    }
+    for (uint32_t i = 0; i < g->num_banned_nodes; i++) {
+        if (g->banned_nodes[i] >= (uint32_t)g->n) return -1;
+    }
+    for (uint32_t i = 0; i < 2 * g->num_banned_edges; i++) {
+        if (g->banned_edges[i] >= (uint32_t)g->n) return -1;
+    }
+    for (uint32_t i = 0; i < g->num_waypoints; i++) {
+        if (g->waypoints[i] >= (uint32_t)g->n) return -1;
+    }
+    return 0;
+}
+
+// Maps path and decodes it in place with key. The arrays point into the
+// private mapping and stay writable until trilogy_graph_close.
+TRILOGY_API int trilogy_graph_open(const char* path, uint8_t key, struct trilogy_graph* g) {
+    memset(g, 0, sizeof(*g));
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        if (fd >= 0) close(fd);
+        return TRILOGY_GRAPH_EIO;
+    }
+    if ((uint64_t)st.st_size < sizeof(struct trilogy_graph_header)) {
+        close(fd);
+        return TRILOGY_GRAPH_EFORMAT;
+    }
+    void* base = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return TRILOGY_GRAPH_EIO;
+    g->base = base;
+    g->size = (size_t)st.st_size;
+
+    const struct trilogy_graph_header* h = base;
+    uint64_t payload = trilogy_graph_payload(h);
+    if (memcmp(h->magic, TRILOGY_GRAPH_MAGIC, 8) != 0 || h->version != TRILOGY_GRAPH_VERSION ||
+        (h->flags & ~(uint32_t)(TRILOGY_GRAPH_WEIGHTED | TRILOGY_GRAPH_CONSTRAINTS)) ||
+        payload == 0 || payload != g->size - sizeof(*h) ||
+        h->source >= h->n || h->target >= h->n) {
+        trilogy_graph_close(g);
+        return TRILOGY_GRAPH_EFORMAT;
+    }
+
+    uint8_t* p = (uint8_t*)base + sizeof(*h);
+    trilogy_graph_xor(p, (size_t)payload, key);
+    g->n = (int32_t)h->n;
+    g->m = (int64_t)h->m;
+    g->source = (int32_t)h->source;
+    g->target = (int32_t)h->target;
+    g->colors = h->colors;
+    g->row_ptr = (int64_t*)p;
+    p += 8 * ((size_t)g->n + 1);
+    g->col = (int32_t*)p;
+    p += 4 * (size_t)g->m;
+    if (h->flags & TRILOGY_GRAPH_WEIGHTED) {
+        g->weight = (int32_t*)p;
+        p += 4 * (size_t)g->m;
+    }
+    if (h->flags & TRILOGY_GRAPH_CONSTRAINTS) {
+        g->num_banned_nodes = h->num_banned_nodes;
+        g->num_banned_edges = h->num_banned_edges;
+        g->num_waypoints = h->num_waypoints;
+        g->banned_nodes = (const uint32_t*)p;
+        g->banned_edges = g->banned_nodes + g->num_banned_nodes;
+        g->waypoints = g->banned_edges + 2 * (size_t)g->num_banned_edges;
+    }
+
+    if (trilogy_graph_check(g) < 0) {
+        trilogy_graph_close(g);
+        return TRILOGY_GRAPH_EKEY;
+    }
+    return 0;
+}
+
+TRILOGY_API const char* trilogy_graph_strerror(int rc) {
+    switch (rc) {
+    case TRILOGY_GRAPH_EIO: return "cannot open or map the file";
+    case TRILOGY_GRAPH_EFORMAT: return "not a trilogy graph file of this version";
+    case TRILOGY_GRAPH_EKEY: return "graph does not decode under this key";
+    default: return "ok";
+    }
+}
+
+#endif
@@ -0,0 +1,231 @@
+/*
+ * TRILOGY PACK - writes Chromatic Trilogy graph files (see trilogy_graph.h)
+ *
+ * Input is a raw edge file: little-endian uint32 pairs (u, v), or triples
+ * (u, v, w) with -w. Edges are undirected unless -d; duplicates keep the
+ * smallest weight.
+ *
+ *   trilogy_pack [-w] [-d] [-k key] [-n nodes] [-c colors] [-s src] [-t dst]
+ *                [-x node]... [-e u,v]... [-p node]... <edge_file> <graph_file>
+ *
+ *   -k  one-byte XOR key (0 = plain): VERTEX 0x76, PATHFINDER and
+ *       CHROMATIC CORE the XOR of their unlock key's bytes
+ *   -c  color budget for CHROMATIC CORE (default: its chromatic number)
+ *   -x  forbidden node, -e forbidden edge, -p must-visit waypoint
+ *
+ * Build: gcc -O2 -o trilogy_pack trilogy_pack.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "trilogy_graph.h"
+
+#define CONSTRAINT_MAX 4096
+
+struct arc {
+    uint32_t v;
+    int32_t w;
+};
+
+static int arc_cmp(const void* a, const void* b) {
+    const struct arc* x = a;
+    const struct arc* y = b;
+    if (x->v != y->v) return x->v < y->v ? -1 : 1;
+    return (x->w > y->w) - (x->w < y->w);
+}
+
+static int write_all(int fd, const void* data, size_t bytes, uint8_t key) {
+    // Encode through a bounce buffer so the input arrays stay plain
+    static uint8_t buf[1 << 16];
+    const uint8_t* p = data;
+    while (bytes) {
+        size_t chunk = bytes < sizeof(buf) ? bytes : sizeof(buf);
+        memcpy(buf, p, chunk);
+        trilogy_graph_xor(buf, chunk, key);
+        for (size_t off = 0; off < chunk;) {
+            ssize_t w = write(fd, buf + off, chunk - off);
+            if (w <= 0) return -1;
+            off += (size_t)w;
+        }
+        p += chunk;
+        bytes -= chunk;
+    }
+    return 0;
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr, "Usage: %s [-w] [-d] [-k key] [-n nodes] [-c colors] [-s src] [-t dst] "
+                    "[-x node]... [-e u,v]... [-p node]... <edge_file> <graph_file>\n", prog);
+}
+
+int main(int argc, char** argv) {
+    int weighted = 0, directed = 0, opt;
+    uint8_t key = 0;
+    uint64_t min_nodes = 0;
+    uint32_t source = 0, target = UINT32_MAX, colors = 0;
+    static uint32_t banned[CONSTRAINT_MAX], banned_edges[2 * CONSTRAINT_MAX], waypoints[CONSTRAINT_MAX];
+    uint32_t nb = 0, ne = 0, nw = 0;
+    uint32_t max_id = 0;
+    int constrained = 0;
+
+    while ((opt = getopt(argc, argv, "wdk:n:c:s:t:x:e:p:")) != -1) {
+        unsigned long a, b;
+        switch (opt) {
+        case 'w': weighted = 1; break;
+        case 'd': directed = 1; break;
+        case 'k': key = (uint8_t)strtoul(optarg, NULL, 0); break;
+        case 'n': min_nodes = strtoull(optarg, NULL, 0); break;
+        case 'c': colors = (uint32_t)strtoul(optarg, NULL, 0); break;
+        case 's': source = (uint32_t)strtoul(optarg, NULL, 0); constrained = 1; break;
+        case 't': target = (uint32_t)strtoul(optarg, NULL, 0); constrained = 1; break;
+        case 'x':
+        case 'p':
+            if ((opt == 'x' ? nb : nw) == CONSTRAINT_MAX) {
+                fprintf(stderr, "Too many constraints.\n");
+                return 1;
+            }
+            a = strtoul(optarg, NULL, 0);
+            if (opt == 'x') banned[nb++] = (uint32_t)a;
+            else waypoints[nw++] = (uint32_t)a;
+            if (a > max_id) max_id = (uint32_t)a;
+            constrained = 1;
+            break;
+        case 'e':
+            if (ne == CONSTRAINT_MAX || sscanf(optarg, "%lu,%lu", &a, &b) != 2) {
+                fprintf(stderr, "Bad or too many forbidden edges.\n");
+                return 1;
+            }
+            banned_edges[2 * ne] = (uint32_t)a;
+            banned_edges[2 * ne + 1] = (uint32_t)b;
+            ne++;
+            if (a > max_id) max_id = (uint32_t)a;
+            if (b > max_id) max_id = (uint32_t)b;
+            constrained = 1;
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (argc - optind != 2) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    size_t rec = weighted ? 12 : 8;
+    int fd = open(argv[optind], O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0 || st.st_size % rec != 0) {
+        fprintf(stderr, "Edge file must be a sequence of uint32 %s.\n", weighted ? "triples" : "pairs");
+        return 1;
+    }
+    size_t num_in = (size_t)st.st_size / rec;
+    const uint32_t* in = num_in ? mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+    close(fd);
+    if (in == MAP_FAILED) {
+        fprintf(stderr, "Cannot map %s.\n", argv[optind]);
+        return 1;
+    }
+
+    size_t words = rec / 4;
+    for (size_t i = 0; i < num_in; i++) {
+        if (in[words * i] > max_id) max_id = in[words * i];
+        if (in[words * i + 1] > max_id) max_id = in[words * i + 1];
+    }
+    uint64_t n = (uint64_t)max_id + 1;
+    if (min_nodes > n) n = min_nodes;
+    if (target == UINT32_MAX) target = (uint32_t)(n - 1);
+    if (n >= INT32_MAX || source >= n || target >= n) {
+        fprintf(stderr, "Node ids out of range.\n");
+        return 1;
+    }
+
+    // Counting sort by source, then sort and dedupe every row
+    size_t arcs_in = directed ? num_in : 2 * num_in;
+    int64_t* row_ptr = calloc(n + 1, sizeof(int64_t));
+    struct arc* arcs = malloc((arcs_in ? arcs_in : 1) * sizeof(struct arc));
+    if (!row_ptr || !arcs) {
+        fprintf(stderr, "Out of memory.\n");
+        return 1;
+    }
+    for (size_t i = 0; i < num_in; i++) {
+        uint32_t u = in[words * i], v = in[words * i + 1];
+        row_ptr[u + 1]++;
+        if (!directed && u != v) row_ptr[v + 1]++;
+    }
+    for (uint64_t u = 0; u < n; u++) row_ptr[u + 1] += row_ptr[u];
+    int64_t* fill = malloc(n * sizeof(int64_t));
+    if (!fill) {
+        fprintf(stderr, "Out of memory.\n");
+        return 1;
+    }
+    memcpy(fill, row_ptr, n * sizeof(int64_t));
+    for (size_t i = 0; i < num_in; i++) {
+        uint32_t u = in[words * i], v = in[words * i + 1];
+        int32_t w = weighted ? (int32_t)(in[3 * i + 2] > INT32_MAX ? INT32_MAX : in[3 * i + 2]) : 0;
+        arcs[fill[u]++] = (struct arc){ v, w };
+        if (!directed && u != v) arcs[fill[v]++] = (struct arc){ u, w };
+    }
+
+    int64_t m = 0;
+    for (uint64_t u = 0; u < n; u++) {
+        int64_t begin = row_ptr[u], end = fill[u];
+        qsort(arcs + begin, (size_t)(end - begin), sizeof(struct arc), arc_cmp);
+        row_ptr[u] = m;
+        for (int64_t k = begin; k < end; k++) {
+            if (k > begin && arcs[k].v == arcs[k - 1].v) continue;  // sorted: first has min weight
+            arcs[m++] = arcs[k];
+        }
+    }
+    row_ptr[n] = m;
+
+    int32_t* col = malloc((size_t)(m ? m : 1) * sizeof(int32_t));
+    int32_t* weight = malloc((size_t)(m ? m : 1) * sizeof(int32_t));
+    if (!col || !weight) {
+        fprintf(stderr, "Out of memory.\n");
+        return 1;
+    }
+    for (int64_t k = 0; k < m; k++) {
+        col[k] = (int32_t)arcs[k].v;
+        weight[k] = arcs[k].w;
+    }
+
+    struct trilogy_graph_header h = {0};
+    memcpy(h.magic, TRILOGY_GRAPH_MAGIC, 8);
+    h.version = TRILOGY_GRAPH_VERSION;
+    h.flags = (weighted ? TRILOGY_GRAPH_WEIGHTED : 0) | (constrained ? TRILOGY_GRAPH_CONSTRAINTS : 0);
+    h.n = (uint32_t)n;
+    h.m = (uint64_t)m;
+    h.source = source;
+    h.target = target;
+    h.colors = colors;
+    if (constrained) {
+        h.num_banned_nodes = nb;
+        h.num_banned_edges = ne;
+        h.num_waypoints = nw;
+    }
+
+    int out = open(argv[optind + 1], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    int rc = out < 0 || write_all(out, &h, sizeof(h), 0) < 0 ||
+             write_all(out, row_ptr, (n + 1) * sizeof(int64_t), key) < 0 ||
+             write_all(out, col, (size_t)m * sizeof(int32_t), key) < 0 ||
+             (weighted && write_all(out, weight, (size_t)m * sizeof(int32_t), key) < 0) ||
+             (constrained && (write_all(out, banned, nb * sizeof(uint32_t), key) < 0 ||
+                              write_all(out, banned_edges, 2 * ne * sizeof(uint32_t), key) < 0 ||
+                              write_all(out, waypoints, nw * sizeof(uint32_t), key) < 0));
+    if (out >= 0) close(out);
+    if (rc) {
+        fprintf(stderr, "Cannot write %s.\n", argv[optind + 1]);
+        return 1;
+    }
+    printf("Nodes: %llu  Arcs: %lld  Flags: 0x%x  Key: 0x%02x\n",
+           (unsigned long long)n, (long long)m, h.flags, key);
+    return 0;
+}
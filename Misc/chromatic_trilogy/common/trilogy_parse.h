@@ -0,0 +1,128 @@
+/*
+ * Chromatic Trilogy answer lists
+ *
+ * Every verifier takes submissions as separator-joined decimal lists
+ * ("0,2,5:1,3,4", "0,1,3,4,6,8,9", "0,1,2,1,..."). This parser walks the
+ * caller's buffer once: eight bytes are loaded per field, the digit run is
+ * found and converted with SWAR arithmetic, and the range check happens
+ * before the value is handed out. Nothing is copied, tokenised in place
+ * or allocated.
+ */
+
+#ifndef TRILOGY_PARSE_H
+#define TRILOGY_PARSE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Errors from trilogy_list_next and trilogy_parse_list
+#define TRILOGY_PARSE_ESYNTAX -1    // empty field, stray character or separator
+#define TRILOGY_PARSE_ERANGE -2     // value not below the limit
+#define TRILOGY_PARSE_EFULL -3      // more values than the output holds
+
+struct trilogy_list {
+    const char* p;
+    const char* end;
+    uint32_t limit;
+    char sep;
+    int done;
+};
+
+static inline int trilogy_is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static inline const char* trilogy_skip_blanks(const char* p, const char* end) {
+    while (p < end && trilogy_is_blank(*p)) p++;
+    return p;
+}
+
+// Up to eight bytes at p, zero past end, first byte lowest
+static inline uint64_t trilogy_load8(const char* p, const char* end) {
+    uint64_t w = 0;
+    size_t n = (size_t)(end - p);
+    memcpy(&w, p, n < 8 ? n : 8);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    w = __builtin_bswap64(w);
+#endif
+    return w;
+}
+
+// Length of the run of ASCII digits at the start of w (0..8). Each byte's
+// high bit ends up set iff it is not '0'..'9'; no carry crosses a byte.
+static inline unsigned trilogy_digits8(uint64_t w) {
+    const uint64_t high = 0x8080808080808080ULL;
+    uint64_t low7 = w & ~high;
+    uint64_t above = low7 + 0x4646464646464646ULL;     // >= '9' + 1
+    uint64_t at_least = low7 + 0x5050505050505050ULL;  // >= '0'
+    uint64_t nondigit = (w | above | ~at_least) & high;
+    return nondigit ? (unsigned)__builtin_ctzll(nondigit) >> 3 : 8;
+}
+
+// Value of the first d (1..8) digit bytes of w: shift them to the top so
+// the vacated low bytes read as leading zeros, then combine pairwise
+static inline uint64_t trilogy_swar8(uint64_t w, unsigned d) {
+    uint64_t v = (w & 0x0F0F0F0F0F0F0F0FULL) << (8 * (8 - d));
+    v = (v * 10 + (v >> 8)) & 0x00FF00FF00FF00FFULL;
+    v = (v * 100 + (v >> 16)) & 0x0000FFFF0000FFFFULL;
+    return (v * 10000 + (v >> 32)) & 0xFFFFFFFFULL;
+}
+
+// Lists of values below limit separated by sep in [s, end); blanks around
+// a field are skipped and an all-blank range is an empty list
+static inline void trilogy_list_init(struct trilogy_list* l, const char* s, const char* end,
+                                     char sep, uint32_t limit) {
+    l->p = s;
+    l->end = end;
+    l->limit = limit;
+    l->sep = sep;
+    l->done = trilogy_skip_blanks(s, end) == end;
+}
+
+// 1 and the next value, 0 at the end of the list, or a negative error
+static inline int trilogy_list_next(struct trilogy_list* l, int32_t* value) {
+    if (l->done) return 0;
+    const char* p = trilogy_skip_blanks(l->p, l->end);
+    uint64_t w = trilogy_load8(p, l->end);
+    unsigned d = trilogy_digits8(w);
+    if (d == 0) return TRILOGY_PARSE_ESYNTAX;
+    uint64_t v = trilogy_swar8(w, d);
+    p += d;
+    if (d == 8) {
+        // Limits fit in 10 digits: one more chunk at most
+        static const uint32_t pow10[8] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000 };
+        w = trilogy_load8(p, l->end);
+        d = trilogy_digits8(w);
+        if (d == 8) return TRILOGY_PARSE_ERANGE;
+        if (d) v = v * pow10[d] + trilogy_swar8(w, d);
+        p += d;
+    }
+    if (v >= l->limit) return TRILOGY_PARSE_ERANGE;
+
+    p = trilogy_skip_blanks(p, l->end);
+    if (p == l->end) {
+        l->done = 1;
+    } else if (*p++ != l->sep) {
+        return TRILOGY_PARSE_ESYNTAX;
+    }
+    l->p = p;
+    *value = (int32_t)v;
+    return 1;
+}
+
+// Whole list into out[0 .. cap); returns the count or a negative error
+static inline int trilogy_parse_list(const char* s, const char* end, char sep, uint32_t limit,
+                                     int32_t* out, int cap) {
+    struct trilogy_list l;
+    int32_t v;
+    int count = 0, rc;
+    trilogy_list_init(&l, s, end, sep, limit);
+    while ((rc = trilogy_list_next(&l, &v)) > 0) {
+        if (count == cap) return TRILOGY_PARSE_EFULL;
+        out[count++] = v;
+    }
+    return rc < 0 ? rc : count;
+}
+
+#endif
@@ -0,0 +1,327 @@
+/*
+ * Chromatic Trilogy multi-session server (--serve)
+ *
+ * Speaks the --pipe protocol (trilogy_batch.h) over TCP, one session per
+ * connection, so a deployment needs no fork+exec, decrypt or teardown per
+ * player. The graph and the caches derived from it are built once and
+ * shared read-only; a connection costs its session struct, plus whatever
+ * per-player state the binary copies on write (PATHFINDER's congested
+ * weights), and nothing else while idle.
+ *
+ * One worker thread per core, each with its own SO_REUSEPORT listener and
+ * edge-triggered epoll set: the kernel spreads new connections across the
+ * workers and a connection stays on the worker that accepted it, so
+ * workers share nothing mutable. Reads go through one per-worker buffer;
+ * only an incomplete line or records the peer has not taken yet are kept
+ * per connection. Connection sockets stay blocking and every recv and
+ * send passes MSG_DONTWAIT, which saves the fcntl calls per accept.
+ *
+ * A connection gets at most TRILOGY_SERVE_READS reads per turn. One that
+ * still has input waiting goes on its worker's ready list and is resumed
+ * after the other connections' events, so a client that keeps its socket
+ * full cannot starve the rest of its worker.
+ */
+
+#ifndef TRILOGY_SERVE_H
+#define TRILOGY_SERVE_H
+
+#include <errno.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+#include "trilogy_batch.h"
+
+#define TRILOGY_SERVE_LINE (1024 * 1024)    // longest answer line
+#define TRILOGY_SERVE_BACKLOG (1024 * 1024) // unsent records before reading pauses
+#define TRILOGY_SERVE_EVENTS 256
+#define TRILOGY_SERVE_READS 4              // reads per turn of one connection
+
+// What a binary plugs in: its session type and the --pipe answer callback
+struct trilogy_service {
+    size_t session_size;
+    int (*open)(void* session);             // 0, or -1 to refuse the connection
+    void (*close)(void* session);
+    trilogy_answer_fn answer;
+};
+
+struct trilogy_conn {
+    int fd;
+    int closing;                            // "quit" or end of input: drop once sent
+    int paused;                             // input left unread for backpressure
+    int failed;                             // drop at its next turn
+    struct trilogy_conn* next_ready;        // on the ready list while ready is set
+    int ready;
+    char* in;                               // incomplete last line
+    size_t in_len;
+    char* out;                              // records the socket would not take
+    size_t out_off, out_len;
+    _Alignas(max_align_t) unsigned char session[];
+};
+
+struct trilogy_worker {
+    const struct trilogy_service* svc;
+    int listen_fd;
+    int epoll_fd;
+    char* buf;                              // carried line + one read
+    struct trilogy_reply reply;
+    struct trilogy_conn* ready_head;        // used up their reads with input left
+    struct trilogy_conn* ready_tail;
+};
+
+static void trilogy_serve_drop(struct trilogy_worker* w, struct trilogy_conn* c) {
+    w->svc->close(c->session);
+    close(c->fd);
+    free(c->in);
+    free(c->out);
+    free(c);
+}
+
+// Sends the pending records without blocking; what the socket does not
+// take goes to c->out, behind anything already waiting there
+static int trilogy_serve_send(struct trilogy_conn* c, struct trilogy_reply* r) {
+    size_t sent = 0, total = 0;
+    for (int i = 0; i < r->used; i++) total += r->iov[i].iov_len;
+    if (c->out_len == 0 && total) {
+        struct msghdr msg = { .msg_iov = r->iov, .msg_iovlen = (size_t)r->used };
+        ssize_t n;
+        do {
+            n = sendmsg(c->fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+        } while (n < 0 && errno == EINTR);
+        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            trilogy_reply_reset(r);
+            return -1;
+        }
+        sent = n > 0 ? (size_t)n : 0;
+    }
+    if (sent < total) {
+        char* out = realloc(c->out, c->out_len + total - sent);
+        if (!out) {
+            trilogy_reply_reset(r);
+            return -1;
+        }
+        c->out = out;
+        for (int i = 0; i < r->used; i++) {
+            size_t len = r->iov[i].iov_len, skip = sent < len ? sent : len;
+            memcpy(c->out + c->out_len, (char*)r->iov[i].iov_base + skip, len - skip);
+            c->out_len += len - skip;
+            sent -= skip;
+        }
+    }
+    trilogy_reply_reset(r);
+    return 0;
+}
+
+// Sends what c->out holds; the buffer is released once empty
+static int trilogy_serve_drain(struct trilogy_conn* c) {
+    while (c->out_off < c->out_len) {
+        ssize_t n = send(c->fd, c->out + c->out_off, c->out_len - c->out_off,
+                         MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return 0;
+        if (n < 0) return -1;
+        c->out_off += (size_t)n;
+    }
+    free(c->out);
+    c->out = NULL;
+    c->out_off = c->out_len = 0;
+    return 0;
+}
+
+// Reads until the socket would block (edge-triggered) or the turn's reads
+// are used up, answering complete lines as they arrive. Pauses while too
+// many records are unsent; the next EPOLLOUT resumes it. 1 if the turn
+// ended with input possibly left, -1 drops the connection.
+static int trilogy_serve_read(struct trilogy_worker* w, struct trilogy_conn* c) {
+    c->paused = 0;
+    for (int reads = 0; !c->closing; reads++) {
+        if (c->out_len - c->out_off > TRILOGY_SERVE_BACKLOG) {
+            c->paused = 1;
+            return 0;
+        }
+        if (reads == TRILOGY_SERVE_READS) return 1;
+        size_t len = c->in_len;
+        ssize_t got;
+        do {
+            got = recv(c->fd, w->buf + len, TRILOGY_BATCH_READ, MSG_DONTWAIT);
+        } while (got < 0 && errno == EINTR);
+        if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return 0;
+        if (got < 0) return -1;
+        if (len) memcpy(w->buf, c->in, len);
+        if (got == 0) {
+            c->closing = 1;
+            if (len == 0) break;
+            w->buf[len++] = '\n';   // last line without a newline
+        } else {
+            len += (size_t)got;
+        }
+
+        size_t start = 0;
+        int quit = 0;
+        do {
+            start += trilogy_batch_lines(w->buf + start, len - start, c->session, w->svc->answer,
+                                         &w->reply, &quit);
+            if (trilogy_serve_send(c, &w->reply) < 0) return -1;
+        } while (!quit && memchr(w->buf + start, '\n', len - start));
+        if (quit) c->closing = 1;
+
+        // Keep the incomplete tail; an idle connection holds no buffer
+        c->in_len = len - start;
+        if (c->in_len > TRILOGY_SERVE_LINE) return -1;
+        if (c->in_len == 0) {
+            free(c->in);
+            c->in = NULL;
+        } else {
+            char* in = realloc(c->in, c->in_len);
+            if (!in) return -1;
+            c->in = in;
+            memcpy(c->in, w->buf + start, c->in_len);
+        }
+    }
+    return 0;
+}
+
+// Ends c's turn: drops it, or queues it for another turn while input is left
+static void trilogy_serve_done(struct trilogy_worker* w, struct trilogy_conn* c, int rc) {
+    if (rc < 0 || (c->closing && c->out_len == 0)) {
+        trilogy_serve_drop(w, c);
+    } else if (rc > 0) {
+        c->ready = 1;
+        c->next_ready = NULL;
+        if (w->ready_tail) w->ready_tail->next_ready = c;
+        else w->ready_head = c;
+        w->ready_tail = c;
+    }
+}
+
+// One more turn for every connection that was ready before this pass;
+// those still not done go to the back of the list
+static void trilogy_serve_ready(struct trilogy_worker* w) {
+    struct trilogy_conn* c = w->ready_head;
+    w->ready_head = w->ready_tail = NULL;
+    while (c) {
+        struct trilogy_conn* next = c->next_ready;
+        c->ready = 0;
+        trilogy_serve_done(w, c, c->failed ? -1 : trilogy_serve_read(w, c));
+        c = next;
+    }
+}
+
+static void trilogy_serve_accept(struct trilogy_worker* w) {
+    for (;;) {
+        int fd = accept(w->listen_fd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            return;     // EAGAIN, or out of descriptors until some close
+        }
+        struct trilogy_conn* c = calloc(1, sizeof(*c) + w->svc->session_size);
+        if (!c || w->svc->open(c->session) < 0) {
+            free(c);
+            close(fd);
+            continue;
+        }
+        c->fd = fd;
+        struct epoll_event ev = { .events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET, .data.ptr = c };
+        if (epoll_ctl(w->epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) trilogy_serve_drop(w, c);
+    }
+}
+
+static void* trilogy_serve_worker(void* arg) {
+    struct trilogy_worker* w = arg;
+    struct epoll_event events[TRILOGY_SERVE_EVENTS];
+    for (;;) {
+        // Ready connections only poll, so their next turn is not held up
+        int n = epoll_wait(w->epoll_fd, events, TRILOGY_SERVE_EVENTS, w->ready_head ? 0 : -1);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) break;
+        for (int i = 0; i < n; i++) {
+            struct trilogy_conn* c = events[i].data.ptr;
+            if (!c) {
+                trilogy_serve_accept(w);
+                continue;
+            }
+            uint32_t e = events[i].events;
+            int rc = (e & EPOLLERR) ? -1 : 0;
+            if (rc == 0 && (e & EPOLLOUT)) rc = trilogy_serve_drain(c);
+            if (c->ready) {
+                // Its turn comes in the ready pass, which also drops it
+                if (rc < 0) c->failed = 1;
+                continue;
+            }
+            if (rc == 0 && ((e & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) || c->paused)) {
+                rc = trilogy_serve_read(w, c);
+            }
+            trilogy_serve_done(w, c, rc);
+        }
+        trilogy_serve_ready(w);
+    }
+    return NULL;
+}
+
+static int trilogy_serve_listen(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int one = 1;
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons((uint16_t)port),
+                                .sin_addr.s_addr = htonl(INADDR_ANY) };
+    if (fd < 0) return -1;
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) < 0 ||
+        setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) < 0 ||
+        bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, SOMAXCONN) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Serves svc on TCP port with the given number of workers (0 = one per
+// online core). Returns only if startup fails, with a message on stderr.
+TRILOGY_API int trilogy_serve(int port, int workers, const struct trilogy_service* svc) {
+    if (port <= 0 || port > 65535) {
+        fprintf(stderr, "Bad port %d.\n", port);
+        return -1;
+    }
+    if (workers <= 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = cores > 0 ? (int)cores : 1;
+    }
+    struct trilogy_worker* w = calloc((size_t)workers, sizeof(*w));
+    pthread_t* threads = calloc((size_t)workers, sizeof(*threads));
+    if (!w || !threads) {
+        fprintf(stderr, "Out of memory.\n");
+        return -1;
+    }
+
+    // All listeners are bound before any worker starts, so a taken port
+    // fails here rather than in a thread
+    for (int i = 0; i < workers; i++) {
+        struct epoll_event ev = { .events = EPOLLIN | EPOLLET, .data.ptr = NULL };
+        w[i].svc = svc;
+        w[i].listen_fd = trilogy_serve_listen(port);
+        w[i].epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        w[i].buf = malloc(TRILOGY_SERVE_LINE + TRILOGY_BATCH_READ + 1);
+        trilogy_reply_init(&w[i].reply, -1);
+        if (w[i].listen_fd < 0 || w[i].epoll_fd < 0 || !w[i].buf ||
+            epoll_ctl(w[i].epoll_fd, EPOLL_CTL_ADD, w[i].listen_fd, &ev) < 0) {
+            fprintf(stderr, "Cannot serve on port %d: %s\n", port, strerror(errno));
+            return -1;
+        }
+    }
+
+    fprintf(stderr, "Serving on port %d with %d workers.\n", port, workers);
+    for (int i = 1; i < workers; i++) {
+        if (pthread_create(&threads[i], NULL, trilogy_serve_worker, &w[i]) != 0) {
+            fprintf(stderr, "Cannot start worker %d.\n", i);
+            return -1;
+        }
+    }
+    trilogy_serve_worker(&w[0]);
+    return -1;
+}
+
+#endif
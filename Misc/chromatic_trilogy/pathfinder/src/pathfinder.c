@@ -10,6 +10,11 @@
  * 
  * Unlock Key: GRAPHKEY (from VERTEX flag)
  * Flag: L3m0nCTF{p4th_PATHSEED_c4f3b1}
+ *
+ * TRILOGY_GRAPH=<graph_file> replaces the built-in graph, constraints and
+ * endpoints with a trilogy graph file keyed with the unlock key's XOR.
+ *
+ * Build: gcc -O2 -pthread -o pathfinder pathfinder.c
  */
 
 #include <stdio.h>
@@ -18,195 +23,2061 @@
 #include <stdint.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_SIMD 1
+#endif
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../../common/trilogy_crypt.h"
+#include "../../common/trilogy_graph.h"
+#include "../../common/trilogy_parse.h"
+#include "../../common/trilogy_batch.h"
+#include "../../common/trilogy_serve.h"
 
 // ============== MAGIC MARKER ==============
-__attribute__((section(".magic")))
-__attribute__((aligned(4096)))
-static const char magic_marker[32] = "PATHFINDER_V2_CHROMA_HARDENED";
+#define MAGIC_TEXT "PATHFINDER_V2_CHROMA_HARDENED"
+_Static_assert(TRILOGY_MAGIC_FITS(MAGIC_TEXT), "magic marker too long");
+TRILOGY_MAGIC static const char magic_marker[TRILOGY_MAGIC_LEN] = MAGIC_TEXT;
+
+// Bounds of the marker section, provided by the linker
+extern const char __start_trilogy_magic[], __stop_trilogy_magic[];
 
 // ============== CONFIGURATION ==============
 #define NUM_NODES 10
+#define START_NODE 0
+#define END_NODE 9
 
 // Obfuscated unlock key (SEED_A XOR 0x13)
 static const uint8_t obf_unlock[] = {0x40, 0x56, 0x56, 0x57, 0x4c, 0x52, 0x00};
 #define OBFUSCATION_KEY 0x13
 
-// ============== ENCRYPTED GRAPH WEIGHTS ==============
-// XOR encrypted with derived key from unlock string
-// Actual graph has 10 nodes, weighted edges
-// Start: 0, End: 9, Forbidden: nodes 2 and 7
-static uint8_t encrypted_weights[NUM_NODES][NUM_NODES];
-static int weights_decrypted = 0;
+// ============== ENCRYPTED GRAPH WEIGHTS ==============
+// Actual graph has 10 nodes, weighted edges
+// Start: 0, End: 9, Forbidden: nodes 2 and 7
+// Arcs (u, v, w) in CSR order: both directions, rows and targets ascending.
+// The compiler XORs them with the key SEED_A derives (0x09).
+#define PATHFINDER_GRAPH_KEY 0x09
+#define PATHFINDER_ARCS(X) \
+    X(0, 1, 4) X(0, 2, 2) \
+    X(1, 0, 4) X(1, 2, 3) X(1, 3, 5) \
+    X(2, 0, 2) X(2, 1, 3) X(2, 3, 1) X(2, 4, 6) \
+    X(3, 1, 5) X(3, 2, 1) X(3, 4, 2) X(3, 5, 7) \
+    X(4, 2, 6) X(4, 3, 2) X(4, 5, 3) X(4, 6, 4) \
+    X(5, 3, 7) X(5, 4, 3) X(5, 6, 2) X(5, 7, 5) \
+    X(6, 4, 4) X(6, 5, 2) X(6, 7, 3) X(6, 8, 6) \
+    X(7, 5, 5) X(7, 6, 3) X(7, 8, 2) X(7, 9, 8) \
+    X(8, 6, 6) X(8, 7, 2) X(8, 9, 3) \
+    X(9, 7, 8) X(9, 8, 3)
+
+#define ENCRYPT_ARC(u, v, w) { TRILOGY_XOR8(u, PATHFINDER_GRAPH_KEY), \
+                               TRILOGY_XOR8(v, PATHFINDER_GRAPH_KEY), \
+                               TRILOGY_XOR8(w, PATHFINDER_GRAPH_KEY) },
+static const uint8_t encrypted_arcs[][3] = { PATHFINDER_ARCS(ENCRYPT_ARC) };
+#undef ENCRYPT_ARC
+
+#define NUM_ARCS ((int64_t)(sizeof(encrypted_arcs) / sizeof(encrypted_arcs[0])))
+
+static int weights_decrypted = 0;
+
+// ============== CSR GRAPH ==============
+// Compressed sparse row adjacency: the arcs leaving u are
+// col[row_ptr[u] .. row_ptr[u+1]), sorted by target, with matching weights.
+// A graph loaded from a trilogy graph file points straight into its
+// mapping; file.base is set then.
+struct csr_graph {
+    int32_t n;
+    int64_t m;
+    int64_t* row_ptr;
+    int32_t* col;
+    int32_t* weight;
+    struct trilogy_graph file;
+};
+
+#define DIST_INF INT64_MAX
+
+static struct csr_graph graph;
+static int32_t route_src = START_NODE;
+static int32_t route_dst = END_NODE;
+
+// ============== PATH CONSTRAINTS ==============
+// Every constraint is a bitset: forbidden nodes and waypoints by node id,
+// forbidden arcs by CSR arc index. A NULL constraint set means "none".
+#define WAYPOINT_MAX 20   // the DP table has 2^k x k entries, ~170 MB at 20
+
+struct path_constraints {
+    uint64_t* banned_nodes;
+    uint64_t* banned_arcs;
+    uint64_t* waypoints;
+    int32_t waypoint_list[WAYPOINT_MAX];
+    int num_waypoints;
+};
+
+static struct path_constraints constraints;
+
+static inline int bit_test(const uint64_t* set, int64_t i) {
+    return (int)((set[i >> 6] >> (i & 63)) & 1);
+}
+
+static inline void bit_set(uint64_t* set, int64_t i) {
+    set[i >> 6] |= 1ULL << (i & 63);
+}
+
+static inline int node_allowed(const struct path_constraints* pc, int32_t v) {
+    return !pc || !pc->banned_nodes || !bit_test(pc->banned_nodes, v);
+}
+
+// Arc k of the CSR, which ends in v
+static inline int arc_allowed(const struct path_constraints* pc, int64_t k, int32_t v) {
+    return node_allowed(pc, v) && (!pc || !pc->banned_arcs || !bit_test(pc->banned_arcs, k));
+}
+
+// ============== HIDDEN CONSTRAINTS ==============
+// Forbidden nodes - NOT displayed to user
+// Must be discovered via reverse engineering
+__attribute__((section(".constraints")))
+static const int forbidden_nodes[] = {2, 7, -1};
+
+// Forbidden edges (both directions) and must-visit waypoints. Empty for
+// this round; filling them in yields the harder variants.
+__attribute__((section(".constraints")))
+static const int forbidden_edges[][2] = {{-1, -1}};
+
+__attribute__((section(".constraints")))
+static const int must_visit[] = {-1};
+
+// ============== RED HERRING: Fake key check ==============
+__attribute__((used))
+int check_admin_key(const char* key) {
+    // This does nothing useful
+    return strcmp(key, "DEADBEEF") == 0;
+}
+
+// ============== REAL: Unlock verification (obfuscated) ==============
+static int verify_unlock(const char* key) {
+    // Deobfuscate and compare at runtime
+    for (size_t i = 0; obf_unlock[i]; i++) {
+        if ((uint8_t)key[i] != (obf_unlock[i] ^ OBFUSCATION_KEY)) {
+            return 0;
+        }
+    }
+    return key[6] == '\0';  // Ensure same length
+}
+
+// ============== REAL: Derive XOR key from unlock key ==============
+static uint8_t derive_graph_key(const char* unlock) {
+    uint8_t key = 0;
+    for (size_t i = 0; unlock[i]; i++) {
+        key ^= (uint8_t)unlock[i];
+    }
+    return key;  // GRAPHKEY XOR = 'G'^'R'^'A'^'P'^'H'^'K'^'E'^'Y' = 0x1E
+}
+
+// ============== CONSTRAINT CHECK (obfuscated) ==============
+static int is_forbidden(int node) {
+    // Obfuscated check - player must reverse this
+    int check = node ^ 0x05;  // 2 ^ 5 = 7, 7 ^ 5 = 2
+    return (check == 7 || check == 2);
+}
+
+// ============== CSR CONSTRUCTION ==============
+static void csr_free(struct csr_graph* g) {
+    if (g->file.base) {
+        if (!g->file.weight) free(g->weight);
+        trilogy_graph_close(&g->file);
+    } else {
+        free(g->row_ptr);
+        free(g->col);
+        free(g->weight);
+    }
+    memset(g, 0, sizeof(*g));
+}
+
+static int csr_alloc(struct csr_graph* g, int32_t n, int64_t m) {
+    g->n = n;
+    g->m = m;
+    g->row_ptr = calloc((size_t)n + 1, sizeof(int64_t));
+    g->col = malloc((size_t)(m ? m : 1) * sizeof(int32_t));
+    g->weight = malloc((size_t)(m ? m : 1) * sizeof(int32_t));
+    if (!g->row_ptr || !g->col || !g->weight) {
+        csr_free(g);
+        return -1;
+    }
+    return 0;
+}
+
+// Directed arc list (u, v, w) as uint32 triples; counting sort by source,
+// then insertion sort by target inside each (short) row
+static int csr_from_triples(struct csr_graph* g, const uint32_t* t, int64_t m) {
+    uint32_t max_id = 0;
+    for (int64_t i = 0; i < m; i++) {
+        if (t[3 * i] > max_id) max_id = t[3 * i];
+        if (t[3 * i + 1] > max_id) max_id = t[3 * i + 1];
+    }
+    if (max_id >= INT32_MAX) return -1;
+    if (csr_alloc(g, (int32_t)max_id + 1, m) < 0) return -1;
+    
+    for (int64_t i = 0; i < m; i++) g->row_ptr[t[3 * i] + 1]++;
+    for (int32_t u = 0; u < g->n; u++) g->row_ptr[u + 1] += g->row_ptr[u];
+    
+    int64_t* fill = malloc((size_t)g->n * sizeof(int64_t));
+    if (!fill) { csr_free(g); return -1; }
+    memcpy(fill, g->row_ptr, (size_t)g->n * sizeof(int64_t));
+    for (int64_t i = 0; i < m; i++) {
+        int64_t k = fill[t[3 * i]]++;
+        g->col[k] = (int32_t)t[3 * i + 1];
+        g->weight[k] = (int32_t)(t[3 * i + 2] > INT32_MAX ? INT32_MAX : t[3 * i + 2]);
+    }
+    free(fill);
+    
+    for (int32_t u = 0; u < g->n; u++) {
+        for (int64_t i = g->row_ptr[u] + 1; i < g->row_ptr[u + 1]; i++) {
+            int32_t c = g->col[i], w = g->weight[i];
+            int64_t j = i - 1;
+            while (j >= g->row_ptr[u] && g->col[j] > c) {
+                g->col[j + 1] = g->col[j];
+                g->weight[j + 1] = g->weight[j];
+                j--;
+            }
+            g->col[j + 1] = c;
+            g->weight[j + 1] = w;
+        }
+    }
+    return 0;
+}
+
+// Index of arc u->v, or -1 if there is none (binary search in the row)
+static int64_t csr_arc_index(const struct csr_graph* g, int32_t u, int32_t v) {
+    int64_t lo = g->row_ptr[u], hi = g->row_ptr[u + 1];
+    while (lo < hi) {
+        int64_t mid = lo + (hi - lo) / 2;
+        if (g->col[mid] < v) lo = mid + 1;
+        else hi = mid;
+    }
+    return (lo < g->row_ptr[u + 1] && g->col[lo] == v) ? lo : -1;
+}
+
+// Trilogy graph file, used in place; unweighted files get unit weights.
+// Returns 0 or a TRILOGY_GRAPH_* error.
+static int csr_from_file(struct csr_graph* g, const char* path, uint8_t key) {
+    memset(g, 0, sizeof(*g));
+    int rc = trilogy_graph_open(path, key, &g->file);
+    if (rc < 0) return rc;
+    g->n = g->file.n;
+    g->m = g->file.m;
+    g->row_ptr = g->file.row_ptr;
+    g->col = g->file.col;
+    g->weight = g->file.weight;
+    if (!g->weight) {
+        g->weight = malloc((size_t)(g->m ? g->m : 1) * sizeof(int32_t));
+        if (!g->weight) {
+            trilogy_graph_close(&g->file);
+            return TRILOGY_GRAPH_EIO;
+        }
+        for (int64_t k = 0; k < g->m; k++) g->weight[k] = 1;
+    }
+    return 0;
+}
+
+// External graph for the tool modes: a plain trilogy graph file, or raw
+// little-endian uint32 triples (u, v, w), one directed arc each
+static int load_arc_file(const char* path, struct csr_graph* g) {
+    if (trilogy_graph_sniff(path)) {
+        int rc = csr_from_file(g, path, 0);
+        if (rc < 0) printf("Cannot load %s: %s.\n", path, trilogy_graph_strerror(rc));
+        return rc < 0 ? -1 : 0;
+    }
+    
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0 || st.st_size == 0 || st.st_size % 12 != 0) {
+        if (fd >= 0) close(fd);
+        printf("Arc file must be a non-empty sequence of uint32 triples.\n");
+        return -1;
+    }
+    const uint32_t* arcs = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (arcs == MAP_FAILED) {
+        printf("Cannot map %s.\n", path);
+        return -1;
+    }
+    int rc = csr_from_triples(g, arcs, st.st_size / 12);
+    munmap((void*)arcs, (size_t)st.st_size);
+    if (rc < 0) printf("Out of memory.\n");
+    return rc;
+}
+
+// ============== CONSTRAINT CONSTRUCTION ==============
+static void constraints_free(struct path_constraints* pc) {
+    free(pc->banned_nodes);
+    free(pc->banned_arcs);
+    free(pc->waypoints);
+    memset(pc, 0, sizeof(*pc));
+}
+
+static int constraints_init(struct path_constraints* pc, const struct csr_graph* g) {
+    memset(pc, 0, sizeof(*pc));
+    size_t node_words = ((size_t)g->n + 63) / 64;
+    size_t arc_words = ((size_t)g->m + 63) / 64;
+    pc->banned_nodes = calloc(node_words ? node_words : 1, sizeof(uint64_t));
+    pc->banned_arcs = calloc(arc_words ? arc_words : 1, sizeof(uint64_t));
+    pc->waypoints = calloc(node_words ? node_words : 1, sizeof(uint64_t));
+    if (!pc->banned_nodes || !pc->banned_arcs || !pc->waypoints) {
+        constraints_free(pc);
+        return -1;
+    }
+    return 0;
+}
+
+static void ban_edge(struct path_constraints* pc, const struct csr_graph* g, int32_t u, int32_t v) {
+    int64_t k = csr_arc_index(g, u, v);
+    if (k >= 0) bit_set(pc->banned_arcs, k);
+    k = csr_arc_index(g, v, u);
+    if (k >= 0) bit_set(pc->banned_arcs, k);
+}
+
+static int add_waypoint(struct path_constraints* pc, int32_t v) {
+    if (bit_test(pc->waypoints, v)) return 0;
+    if (pc->num_waypoints == WAYPOINT_MAX) return -1;
+    bit_set(pc->waypoints, v);
+    pc->waypoint_list[pc->num_waypoints++] = v;
+    return 0;
+}
+
+// ============== REAL: Decrypt weights ==============
+// Graph, constraints and endpoints from a trilogy graph file instead of
+// the built-in tables
+static void load_graph_file(const char* path, uint8_t key) {
+    int rc = csr_from_file(&graph, path, key);
+    if (rc < 0) {
+        fprintf(stderr, "Cannot load graph %s: %s.\n", path, trilogy_graph_strerror(rc));
+        exit(1);
+    }
+    if (constraints_init(&constraints, &graph) < 0) {
+        fprintf(stderr, "Out of memory.\n");
+        exit(1);
+    }
+    const struct trilogy_graph* f = &graph.file;
+    for (uint32_t i = 0; i < f->num_banned_nodes; i++) {
+        bit_set(constraints.banned_nodes, f->banned_nodes[i]);
+    }
+    for (uint32_t i = 0; i < f->num_banned_edges; i++) {
+        ban_edge(&constraints, &graph, f->banned_edges[2 * i], f->banned_edges[2 * i + 1]);
+    }
+    for (uint32_t i = 0; i < f->num_waypoints; i++) {
+        if (add_waypoint(&constraints, f->waypoints[i]) < 0) {
+            fprintf(stderr, "Graph %s has more than %d waypoints.\n", path, WAYPOINT_MAX);
+            exit(1);
+        }
+    }
+    route_src = f->source;
+    route_dst = f->target;
+}
+
+static void decrypt_weights(const char* unlock) {
+    if (weights_decrypted) return;
+    
+    uint8_t key = derive_graph_key(unlock);
+    
+    const char* path = getenv(TRILOGY_GRAPH_ENV);
+    if (path) {
+        load_graph_file(path, key);
+        weights_decrypted = 1;
+        return;
+    }
+    
+    // The arcs are already in CSR order: one pass decodes them into place
+    // and counts the rows, a prefix sum finishes row_ptr
+    if (csr_alloc(&graph, NUM_NODES, NUM_ARCS) < 0) {
+        fprintf(stderr, "Out of memory.\n");
+        exit(1);
+    }
+    for (int64_t k = 0; k < NUM_ARCS; k++) {
+        uint8_t u = encrypted_arcs[k][0] ^ key;
+        graph.col[k] = encrypted_arcs[k][1] ^ key;
+        graph.weight[k] = encrypted_arcs[k][2] ^ key;
+        if (u < NUM_NODES) graph.row_ptr[u + 1]++;
+    }
+    for (int32_t u = 0; u < NUM_NODES; u++) graph.row_ptr[u + 1] += graph.row_ptr[u];
+    if (constraints_init(&constraints, &graph) < 0) {
+        fprintf(stderr, "Out of memory.\n");
+        exit(1);
+    }
+    for (int v = 0; v < NUM_NODES; v++) {
+        if (is_forbidden(v)) bit_set(constraints.banned_nodes, v);
+    }
+    for (int i = 0; forbidden_edges[i][0] != -1; i++) {
+        ban_edge(&constraints, &graph, forbidden_edges[i][0], forbidden_edges[i][1]);
+    }
+    for (int i = 0; must_visit[i] != -1; i++) {
+        add_waypoint(&constraints, must_visit[i]);
+    }
+    
+    weights_decrypted = 1;
+}
+
+// ============== PATH VERIFICATION ==============
+// Checks a comma-separated route from src to dst in g (the shared graph or
+// a session's congested copy) against the constraint bitsets and returns
+// its cost. The route is checked hop by hop as it is
+// parsed; errors keep their precedence (length, then endpoints, then the
+// first bad hop, then waypoints).
+static int verify_route(const struct csr_graph* g, const char* path_str, int32_t src, int32_t dst,
+                        int64_t* cost) {
+    const struct path_constraints* pc = &constraints;
+    struct trilogy_list list;
+    int32_t node, first = -1, prev = -1;
+    int count = 0, hop = 1, rc;
+    uint32_t visited = 0;  // bit i = waypoint_list[i] seen
+    
+    *cost = 0;
+    trilogy_list_init(&list, path_str, path_str + strlen(path_str), ',', INT32_MAX);
+    while ((rc = trilogy_list_next(&list, &node)) > 0) {
+        if (count++ == 0) first = node;
+        int from = prev;
+        prev = node;
+        if (hop != 1) continue;
+        
+        int in_range = node < g->n;
+        
+        // Check forbidden
+        if (in_range && !node_allowed(pc, node)) {
+            hop = -4;  // Forbidden node used
+            continue;
+        }
+        if (in_range && bit_test(pc->waypoints, node)) {
+            for (int w = 0; w < pc->num_waypoints; w++) {
+                if (pc->waypoint_list[w] == node) visited |= 1u << w;
+            }
+        }
+        
+        // Calculate cost
+        if (count > 1) {
+            if (from >= g->n || !in_range) {
+                hop = -5;
+                continue;
+            }
+            int64_t k = csr_arc_index(g, from, node);
+            if (k < 0) {
+                hop = -6;  // No edge
+                continue;
+            }
+            if (!arc_allowed(pc, k, node)) {
+                hop = -7;  // Forbidden edge used
+                continue;
+            }
+            *cost += g->weight[k];
+        }
+    }
+    
+    if (rc < 0 || count < 2) return -1;
+    if (first != src) return -2;
+    if (prev != dst) return -3;
+    if (hop != 1) return hop;
+    if (pc->num_waypoints > 0 && visited != (uint32_t)((1ULL << pc->num_waypoints) - 1)) {
+        return -8;  // Missed a waypoint
+    }
+    return 1;
+}
+
+static int verify_path(const struct csr_graph* g, const char* path_str, int64_t* cost) {
+    // Must start at 0, must end at 9
+    return verify_route(g, path_str, route_src, route_dst, cost);
+}
+
+// ============== SHORTEST PATH ENGINE ==============
+// Dijkstra over the CSR graph with a radix heap keyed on 64-bit distances.
+// Dijkstra pops keys in non-decreasing order, so an entry only needs to
+// live in the bucket of the highest bit where it differs from the last
+// popped key; each entry moves down at most 64 times. Insertions are
+// lazy (no decrease-key), stale entries are skipped when popped.
+struct heap_entry {
+    int64_t key;
+    int32_t node;
+};
+
+struct radix_heap {
+    struct heap_entry* bucket[65];
+    size_t len[65];
+    size_t cap[65];
+    int64_t last;
+    size_t size;
+};
+
+static inline int radix_bucket(int64_t key, int64_t last) {
+    return key == last ? 0 : 64 - __builtin_clzll((uint64_t)(key ^ last));
+}
+
+static int radix_append(struct radix_heap* h, int b, struct heap_entry x) {
+    if (h->len[b] == h->cap[b]) {
+        size_t cap = h->cap[b] ? h->cap[b] * 2 : 64;
+        struct heap_entry* p = realloc(h->bucket[b], cap * sizeof(*p));
+        if (!p) return -1;
+        h->bucket[b] = p;
+        h->cap[b] = cap;
+    }
+    h->bucket[b][h->len[b]++] = x;
+    return 0;
+}
+
+// key must be >= the last popped key
+static int radix_push(struct radix_heap* h, int64_t key, int32_t node) {
+    struct heap_entry x = { key, node };
+    if (radix_append(h, radix_bucket(key, h->last), x) < 0) return -1;
+    h->size++;
+    return 0;
+}
+
+static struct heap_entry radix_pop(struct radix_heap* h) {
+    if (h->len[0] == 0) {
+        // Refill bucket 0 from the first non-empty bucket: its minimum
+        // becomes the new reference, all of its entries move lower.
+        int b = 1;
+        while (h->len[b] == 0) b++;
+        int64_t min = INT64_MAX;
+        for (size_t i = 0; i < h->len[b]; i++) {
+            if (h->bucket[b][i].key < min) min = h->bucket[b][i].key;
+        }
+        h->last = min;
+        for (size_t i = 0; i < h->len[b]; i++) {
+            struct heap_entry x = h->bucket[b][i];
+            // Always lands strictly below b; out of memory here is fatal
+            int nb = radix_bucket(x.key, min);
+            if (radix_append(h, nb, x) < 0) abort();
+        }
+        h->len[b] = 0;
+    }
+    h->size--;
+    return h->bucket[0][--h->len[0]];
+}
+
+static void radix_free(struct radix_heap* h) {
+    for (int b = 0; b < 65; b++) free(h->bucket[b]);
+    memset(h, 0, sizeof(*h));
+}
+
+// Single-source shortest paths from src. Forbidden nodes and arcs in pc are
+// never entered. dist[] gets DIST_INF for unreachable nodes; pred[] (may
+// be NULL) gets the predecessor on one shortest path, -1 for none.
+static int sssp_dijkstra(const struct csr_graph* g, int32_t src, const struct path_constraints* pc,
+                         int64_t* dist, int32_t* pred) {
+    for (int32_t v = 0; v < g->n; v++) {
+        dist[v] = DIST_INF;
+        if (pred) pred[v] = -1;
+    }
+    if (src < 0 || src >= g->n || !node_allowed(pc, src)) {
+        return 0;
+    }
+    
+    struct radix_heap h = {0};
+    dist[src] = 0;
+    if (radix_push(&h, 0, src) < 0) return -1;
+    
+    while (h.size > 0) {
+        struct heap_entry top = radix_pop(&h);
+        int32_t u = top.node;
+        if (top.key > dist[u]) continue;  // stale
+        
+        for (int64_t k = g->row_ptr[u]; k < g->row_ptr[u + 1]; k++) {
+            int32_t v = g->col[k];
+            if (!arc_allowed(pc, k, v)) continue;
+            int64_t nd = top.key + g->weight[k];
+            if (nd < dist[v]) {
+                dist[v] = nd;
+                if (pred) pred[v] = u;
+                if (radix_push(&h, nd, v) < 0) {
+                    radix_free(&h);
+                    return -1;
+                }
+            }
+        }
+    }
+    
+    radix_free(&h);
+    return 0;
+}
+
+// ============== WORKER POOL ==============
+// Persistent threads released in lock-step by a barrier: pool_run() hands
+// the same function to every worker (the caller acts as worker 0) and
+// returns once all of them have finished.
+struct worker_pool;
+
+struct worker_slot {
+    struct worker_pool* pool;
+    int tid;
+};
+
+struct worker_pool {
+    int nthreads;
+    pthread_t* threads;
+    struct worker_slot* slots;
+    pthread_barrier_t start, done;
+    void (*fn)(int tid, int nthreads, void* arg);
+    void* arg;
+    int stop;
+};
+
+static void* pool_worker(void* p) {
+    struct worker_slot* slot = p;
+    struct worker_pool* pool = slot->pool;
+    for (;;) {
+        pthread_barrier_wait(&pool->start);
+        if (pool->stop) break;
+        pool->fn(slot->tid, pool->nthreads, pool->arg);
+        pthread_barrier_wait(&pool->done);
+    }
+    return NULL;
+}
+
+static int pool_init(struct worker_pool* pool, int nthreads) {
+    memset(pool, 0, sizeof(*pool));
+    pool->nthreads = nthreads < 1 ? 1 : nthreads;
+    pool->threads = malloc((size_t)pool->nthreads * sizeof(pthread_t));
+    pool->slots = malloc((size_t)pool->nthreads * sizeof(struct worker_slot));
+    if (!pool->threads || !pool->slots) {
+        free(pool->threads);
+        free(pool->slots);
+        return -1;
+    }
+    pthread_barrier_init(&pool->start, NULL, (unsigned)pool->nthreads);
+    pthread_barrier_init(&pool->done, NULL, (unsigned)pool->nthreads);
+    
+    for (int t = 1; t < pool->nthreads; t++) {
+        pool->slots[t].pool = pool;
+        pool->slots[t].tid = t;
+        if (pthread_create(&pool->threads[t], NULL, pool_worker, &pool->slots[t]) != 0) {
+            // Barriers are sized for nthreads; a missing worker would deadlock
+            fprintf(stderr, "pthread_create failed, aborting.\n");
+            abort();
+        }
+    }
+    return 0;
+}
+
+static void pool_run(struct worker_pool* pool, void (*fn)(int, int, void*), void* arg) {
+    pool->fn = fn;
+    pool->arg = arg;
+    if (pool->nthreads > 1) pthread_barrier_wait(&pool->start);
+    fn(0, pool->nthreads, arg);
+    if (pool->nthreads > 1) pthread_barrier_wait(&pool->done);
+}
+
+static void pool_destroy(struct worker_pool* pool) {
+    pool->stop = 1;
+    if (pool->nthreads > 1) pthread_barrier_wait(&pool->start);
+    for (int t = 1; t < pool->nthreads; t++) {
+        pthread_join(pool->threads[t], NULL);
+    }
+    pthread_barrier_destroy(&pool->start);
+    pthread_barrier_destroy(&pool->done);
+    free(pool->threads);
+    free(pool->slots);
+}
+
+static int online_cpus(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+}
+
+// ============== PARALLEL DELTA-STEPPING ==============
+// Meyer & Sanders delta-stepping. Nodes sit in buckets of width delta by
+// tentative distance; the lowest bucket is emptied by repeated parallel
+// relaxation of light arcs (w <= delta), then heavy arcs of everything
+// settled in it are relaxed once. Distances are lowered with an atomic
+// min, so the result is the exact integer distance, identical to
+// sssp_dijkstra. Buckets are a ring of max_w / delta + 2 slots.
+struct node_vec {
+    int32_t* a;
+    size_t n, cap;
+};
+
+static int node_vec_push(struct node_vec* v, int32_t x) {
+    if (v->n == v->cap) {
+        size_t cap = v->cap ? v->cap * 2 : 256;
+        int32_t* p = realloc(v->a, cap * sizeof(int32_t));
+        if (!p) return -1;
+        v->a = p;
+        v->cap = cap;
+    }
+    v->a[v->n++] = x;
+    return 0;
+}
+
+static inline int atomic_min_i64(int64_t* p, int64_t v) {
+    int64_t cur = __atomic_load_n(p, __ATOMIC_RELAXED);
+    while (v < cur) {
+        if (__atomic_compare_exchange_n(p, &cur, v, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+struct delta_ctx {
+    const struct csr_graph* g;
+    const struct path_constraints* pc;
+    int64_t* dist;
+    int64_t delta;
+    const int32_t* items;
+    size_t count;
+    int heavy;              // relax arcs with w > delta instead of w <= delta
+    struct node_vec* out;   // per thread: nodes whose distance dropped
+    int failed;
+};
+
+static void delta_relax_worker(int tid, int nthreads, void* arg) {
+    struct delta_ctx* c = arg;
+    const struct csr_graph* g = c->g;
+    size_t begin = c->count * (size_t)tid / (size_t)nthreads;
+    size_t end = c->count * (size_t)(tid + 1) / (size_t)nthreads;
+    struct node_vec* out = &c->out[tid];
+    
+    for (size_t i = begin; i < end; i++) {
+        int32_t u = c->items[i];
+        int64_t du = __atomic_load_n(&c->dist[u], __ATOMIC_RELAXED);
+        for (int64_t k = g->row_ptr[u]; k < g->row_ptr[u + 1]; k++) {
+            int32_t w = g->weight[k];
+            if ((w > c->delta) != c->heavy) continue;
+            int32_t v = g->col[k];
+            if (!arc_allowed(c->pc, k, v)) continue;
+            if (atomic_min_i64(&c->dist[v], du + w) && node_vec_push(out, v) < 0) {
+                __atomic_store_n(&c->failed, 1, __ATOMIC_RELAXED);
+            }
+        }
+    }
+}
+
+static int sssp_delta_stepping(const struct csr_graph* g, int32_t src, const struct path_constraints* pc,
+                               int64_t* dist, int64_t delta, int nthreads) {
+    for (int32_t v = 0; v < g->n; v++) dist[v] = DIST_INF;
+    if (src < 0 || src >= g->n || !node_allowed(pc, src)) return 0;
+    
+    int32_t max_w = 1;
+    for (int64_t k = 0; k < g->m; k++) {
+        if (g->weight[k] > max_w) max_w = g->weight[k];
+    }
+    if (delta < 1) delta = 1;
+    size_t nb = (size_t)(max_w / delta) + 2;
+    
+    struct worker_pool pool;
+    if (pool_init(&pool, nthreads) < 0) return -1;
+    
+    struct node_vec* buckets = calloc(nb, sizeof(struct node_vec));
+    struct node_vec* out = calloc((size_t)pool.nthreads, sizeof(struct node_vec));
+    uint32_t* stamp_f = calloc((size_t)g->n, sizeof(uint32_t));
+    uint32_t* stamp_s = calloc((size_t)g->n, sizeof(uint32_t));
+    struct node_vec frontier = {0}, next = {0}, settled = {0};
+    int rc = -1;
+    if (!buckets || !out || !stamp_f || !stamp_s) goto out;
+    
+    struct delta_ctx c = { g, pc, dist, delta, NULL, 0, 0, out, 0 };
+    uint32_t round = 0;
+    size_t remaining = 1;
+    int64_t b = 0;
+    dist[src] = 0;
+    if (node_vec_push(&buckets[0], src) < 0) goto out;
+    
+    while (remaining > 0) {
+        while (buckets[b % nb].n == 0) b++;
+        struct node_vec* cur = &buckets[b % nb];
+        remaining -= cur->n;
+        
+        // Frontier: live (non-stale) entries of bucket b, deduplicated
+        round++;
+        frontier.n = 0;
+        for (size_t i = 0; i < cur->n; i++) {
+            int32_t v = cur->a[i];
+            if (dist[v] / delta == b && stamp_f[v] != round) {
+                stamp_f[v] = round;
+                if (node_vec_push(&frontier, v) < 0) goto out;
+            }
+        }
+        cur->n = 0;
+        settled.n = 0;
+        
+        while (frontier.n > 0) {
+            c.items = frontier.a;
+            c.count = frontier.n;
+            c.heavy = 0;
+            pool_run(&pool, delta_relax_worker, &c);
+            if (c.failed) goto out;
+            
+            for (size_t i = 0; i < frontier.n; i++) {
+                int32_t v = frontier.a[i];
+                if (stamp_s[v] != (uint32_t)(b + 1) && node_vec_push(&settled, v) < 0) goto out;
+                stamp_s[v] = (uint32_t)(b + 1);
+            }
+            
+            // Improved nodes either stay in bucket b (next light round)
+            // or move to a later bucket
+            round++;
+            next.n = 0;
+            for (int t = 0; t < pool.nthreads; t++) {
+                for (size_t i = 0; i < out[t].n; i++) {
+                    int32_t v = out[t].a[i];
+                    int64_t bv = dist[v] / delta;
+                    if (bv == b) {
+                        if (stamp_f[v] == round) continue;
+                        stamp_f[v] = round;
+                        if (node_vec_push(&next, v) < 0) goto out;
+                    } else {
+                        if (node_vec_push(&buckets[bv % nb], v) < 0) goto out;
+                        remaining++;
+                    }
+                }
+                out[t].n = 0;
+            }
+            struct node_vec tmp = frontier;
+            frontier = next;
+            next = tmp;
+        }
+        
+        // Heavy arcs from everything settled in bucket b land in later buckets
+        c.items = settled.a;
+        c.count = settled.n;
+        c.heavy = 1;
+        pool_run(&pool, delta_relax_worker, &c);
+        if (c.failed) goto out;
+        for (int t = 0; t < pool.nthreads; t++) {
+            for (size_t i = 0; i < out[t].n; i++) {
+                int32_t v = out[t].a[i];
+                if (node_vec_push(&buckets[(dist[v] / delta) % nb], v) < 0) goto out;
+                remaining++;
+            }
+            out[t].n = 0;
+        }
+        b++;
+    }
+    rc = 0;
+    
+out:
+    pool_destroy(&pool);
+    for (size_t i = 0; buckets && i < nb; i++) free(buckets[i].a);
+    for (int t = 0; out && t < pool.nthreads; t++) free(out[t].a);
+    free(buckets);
+    free(out);
+    free(stamp_f);
+    free(stamp_s);
+    free(frontier.a);
+    free(next.a);
+    free(settled.a);
+    return rc;
+}
+
+// Predecessors consistent with final distances: a BFS from src over the
+// tight arcs (dist[u] + w == dist[v]). Every node is entered once, from a
+// node already in the tree, so zero-weight arcs are used without forming
+// cycles. Deterministic for any engine.
+static int sssp_fill_pred(const struct csr_graph* g, int32_t src, const struct path_constraints* pc,
+                          const int64_t* dist, int32_t* pred) {
+    for (int32_t v = 0; v < g->n; v++) pred[v] = -1;
+    if (src < 0 || src >= g->n || dist[src] == DIST_INF) return 0;
+    
+    int32_t* queue = malloc((size_t)g->n * sizeof(int32_t));
+    if (!queue) return -1;
+    int32_t head = 0, tail = 0;
+    queue[tail++] = src;
+    pred[src] = src;  // marks the root as entered; reset below
+    while (head < tail) {
+        int32_t u = queue[head++];
+        for (int64_t k = g->row_ptr[u]; k < g->row_ptr[u + 1]; k++) {
+            int32_t v = g->col[k];
+            if (pred[v] >= 0 || !arc_allowed(pc, k, v)) continue;
+            if (dist[u] + g->weight[k] != dist[v]) continue;
+            pred[v] = u;
+            queue[tail++] = v;
+        }
+    }
+    pred[src] = -1;
+    free(queue);
+    return 0;
+}
+
+// ============== ENGINE SELECTION ==============
+// PATHFINDER_ENGINE=dijkstra|delta, PATHFINDER_THREADS=<n> (default: all
+// online CPUs), PATHFINDER_DELTA=<bucket width> (default: max weight over
+// average out-degree).
+enum sssp_engine { ENGINE_DIJKSTRA, ENGINE_DELTA };
+
+static enum sssp_engine sssp_engine = ENGINE_DIJKSTRA;
+static int sssp_threads = 1;
+static int64_t sssp_delta = 0;
+
+static void configure_engine(void) {
+    const char* e = getenv("PATHFINDER_ENGINE");
+    if (e && strcmp(e, "delta") == 0) sssp_engine = ENGINE_DELTA;
+    
+    const char* t = getenv("PATHFINDER_THREADS");
+    sssp_threads = t ? atoi(t) : online_cpus();
+    if (sssp_threads < 1) sssp_threads = 1;
+    
+    const char* d = getenv("PATHFINDER_DELTA");
+    if (d) sssp_delta = atoll(d);
+}
+
+static int sssp_run(const struct csr_graph* g, int32_t src, const struct path_constraints* pc,
+                    int64_t* dist, int32_t* pred) {
+    if (sssp_engine == ENGINE_DIJKSTRA) {
+        return sssp_dijkstra(g, src, pc, dist, pred);
+    }
+    
+    int64_t delta = sssp_delta;
+    if (delta < 1) {
+        int32_t max_w = 1;
+        for (int64_t k = 0; k < g->m; k++) {
+            if (g->weight[k] > max_w) max_w = g->weight[k];
+        }
+        int64_t avg_degree = g->n ? g->m / g->n : 1;
+        delta = max_w / (avg_degree > 0 ? avg_degree : 1);
+    }
+    if (sssp_delta_stepping(g, src, pc, dist, delta, sssp_threads) < 0) return -1;
+    return pred ? sssp_fill_pred(g, src, pc, dist, pred) : 0;
+}
+
+// ============== ALT POINT-TO-POINT QUERIES ==============
+// A* with landmark lower bounds (Goldberg & Harrelson). Preprocessing
+// stores d(L, v) and d(v, L) for a few landmarks L; by the triangle
+// inequality h(v) = max_L max(d(L,t) - d(L,v), d(v,L) - d(t,L)) never
+// overestimates d(v, t) and is consistent, so A* keys stay monotone and
+// the radix heap still applies. Query scratch is valid only where a
+// node's stamp matches the current query, so a query only costs what it
+// visits and nothing needs resetting afterwards.
+#define ALT_DEFAULT_LANDMARKS 8
+
+struct alt_index {
+    const struct csr_graph* g;
+    const struct path_constraints* pc;
+    struct csr_graph rev;
+    struct path_constraints rev_pc;  // pc with arc bits in reverse-CSR order
+    int k;
+    int32_t* landmarks;
+    int64_t* from_lm;   // k * n: d(L_i, v)
+    int64_t* to_lm;     // k * n: d(v, L_i)
+    int64_t* g_cost;    // query scratch, valid where stamp[v] == query
+    int64_t* h_cost;
+    uint32_t* stamp;
+    uint32_t query;
+    uint64_t settled;   // nodes settled by the last query
+};
+
+// perm (optional, m entries) maps each reverse arc to its forward arc index
+static int csr_transpose(const struct csr_graph* g, struct csr_graph* rt, int64_t* perm) {
+    if (csr_alloc(rt, g->n, g->m) < 0) return -1;
+    for (int64_t k = 0; k < g->m; k++) rt->row_ptr[g->col[k] + 1]++;
+    for (int32_t v = 0; v < g->n; v++) rt->row_ptr[v + 1] += rt->row_ptr[v];
+    
+    int64_t* fill = malloc((size_t)g->n * sizeof(int64_t));
+    if (!fill) { csr_free(rt); return -1; }
+    memcpy(fill, rt->row_ptr, (size_t)g->n * sizeof(int64_t));
+    // Sources are visited in increasing order, so rows come out sorted
+    for (int32_t u = 0; u < g->n; u++) {
+        for (int64_t k = g->row_ptr[u]; k < g->row_ptr[u + 1]; k++) {
+            int64_t j = fill[g->col[k]]++;
+            rt->col[j] = u;
+            rt->weight[j] = g->weight[k];
+            if (perm) perm[j] = k;
+        }
+    }
+    free(fill);
+    return 0;
+}
+
+static void alt_free(struct alt_index* a) {
+    csr_free(&a->rev);
+    free(a->rev_pc.banned_arcs);  // banned_nodes is shared with pc
+    free(a->landmarks);
+    free(a->from_lm);
+    free(a->to_lm);
+    free(a->g_cost);
+    free(a->h_cost);
+    free(a->stamp);
+    memset(a, 0, sizeof(*a));
+}
+
+// Farthest-point landmark selection: each new landmark maximises its
+// distance to the closest landmark chosen so far.
+static int alt_prepare(struct alt_index* a, const struct csr_graph* g, const struct path_constraints* pc,
+                       int32_t seed, int want) {
+    alt_free(a);
+    a->g = g;
+    a->pc = pc;
+    size_t n = (size_t)g->n;
+    if (want > g->n) want = g->n;
+    
+    a->landmarks = malloc((size_t)want * sizeof(int32_t));
+    a->from_lm = malloc((size_t)want * n * sizeof(int64_t));
+    a->to_lm = malloc((size_t)want * n * sizeof(int64_t));
+    a->g_cost = malloc(n * sizeof(int64_t));
+    a->h_cost = malloc(n * sizeof(int64_t));
+    a->stamp = calloc(n, sizeof(uint32_t));
+    int64_t* nearest = malloc(n * sizeof(int64_t));
+    int64_t* perm = malloc((size_t)(g->m ? g->m : 1) * sizeof(int64_t));
+    if (!a->landmarks || !a->from_lm || !a->to_lm || !a->g_cost || !a->h_cost ||
+        !a->stamp || !nearest || !perm || csr_transpose(g, &a->rev, perm) < 0) {
+        free(nearest);
+        free(perm);
+        alt_free(a);
+        return -1;
+    }
+    
+    // Same constraints for the reverse searches, arc bits permuted
+    const struct path_constraints* rev_pc = NULL;
+    if (pc) {
+        a->rev_pc.banned_nodes = pc->banned_nodes;
+        if (pc->banned_arcs) {
+            a->rev_pc.banned_arcs = calloc(((size_t)g->m + 63) / 64 + 1, sizeof(uint64_t));
+            if (!a->rev_pc.banned_arcs) {
+                free(nearest);
+                free(perm);
+                alt_free(a);
+                return -1;
+            }
+            for (int64_t j = 0; j < g->m; j++) {
+                if (bit_test(pc->banned_arcs, perm[j])) bit_set(a->rev_pc.banned_arcs, j);
+            }
+        }
+        rev_pc = &a->rev_pc;
+    }
+    free(perm);
+    
+    // Start from the node farthest from the seed
+    if (sssp_run(g, seed, pc, nearest, NULL) < 0) {
+        free(nearest);
+        alt_free(a);
+        return -1;
+    }
+    
+    while (a->k < want) {
+        int32_t pick = -1;
+        int64_t best = -1;
+        for (size_t v = 0; v < n; v++) {
+            if (nearest[v] != DIST_INF && nearest[v] > best) {
+                best = nearest[v];
+                pick = (int32_t)v;
+            }
+        }
+        if (pick < 0 || (a->k > 0 && best == 0)) break;
+        
+        int64_t* from = a->from_lm + (size_t)a->k * n;
+        int64_t* to = a->to_lm + (size_t)a->k * n;
+        if (sssp_run(g, pick, pc, from, NULL) < 0 ||
+            sssp_run(&a->rev, pick, rev_pc, to, NULL) < 0) {
+            free(nearest);
+            alt_free(a);
+            return -1;
+        }
+        a->landmarks[a->k++] = pick;
+        
+        if (a->k == 1) {
+            memcpy(nearest, from, n * sizeof(int64_t));
+        } else {
+            for (size_t v = 0; v < n; v++) {
+                if (from[v] < nearest[v]) nearest[v] = from[v];
+            }
+        }
+    }
+    
+    free(nearest);
+    return 0;
+}
+
+// Lower bound on d(v, t); DIST_INF when a landmark proves t unreachable
+static int64_t alt_bound(const struct alt_index* a, int32_t v, int32_t t) {
+    size_t n = (size_t)a->g->n;
+    int64_t h = 0;
+    for (int i = 0; i < a->k; i++) {
+        const int64_t* from = a->from_lm + (size_t)i * n;
+        const int64_t* to = a->to_lm + (size_t)i * n;
+        
+        if (from[v] != DIST_INF) {
+            if (from[t] == DIST_INF) return DIST_INF;  // L reaches v but not t
+            if (from[t] - from[v] > h) h = from[t] - from[v];
+        }
+        if (to[t] != DIST_INF) {
+            if (to[v] == DIST_INF) return DIST_INF;    // t reaches L but v does not
+            if (to[v] - to[t] > h) h = to[v] - to[t];
+        }
+    }
+    return h;
+}
+
+// First visit of v in this query, including nodes the bound rules out
+static void alt_touch(struct alt_index* a, int32_t v, int32_t t) {
+    if (a->stamp[v] == a->query) return;
+    a->stamp[v] = a->query;
+    a->g_cost[v] = DIST_INF;
+    a->h_cost[v] = alt_bound(a, v, t);
+}
+
+static int64_t alt_query(struct alt_index* a, int32_t s, int32_t t) {
+    const struct csr_graph* g = a->g;
+    int64_t result = DIST_INF;
+    a->settled = 0;
+    if (s < 0 || s >= g->n || t < 0 || t >= g->n) return DIST_INF;
+    if (!node_allowed(a->pc, s) || !node_allowed(a->pc, t)) return DIST_INF;
+    if (++a->query == 0) {
+        memset(a->stamp, 0, (size_t)g->n * sizeof(uint32_t));
+        a->query = 1;
+    }
+    
+    struct radix_heap h = {0};
+    alt_touch(a, s, t);
+    a->g_cost[s] = 0;
+    if (a->h_cost[s] == DIST_INF || radix_push(&h, a->h_cost[s], s) < 0) goto out;
+    
+    while (h.size > 0) {
+        struct heap_entry top = radix_pop(&h);
+        int32_t u = top.node;
+        if (top.key > a->g_cost[u] + a->h_cost[u]) continue;  // stale
+        a->settled++;
+        if (u == t) {
+            result = a->g_cost[u];
+            break;
+        }
+        
+        for (int64_t k = g->row_ptr[u]; k < g->row_ptr[u + 1]; k++) {
+            int32_t v = g->col[k];
+            if (!arc_allowed(a->pc, k, v)) continue;
+            int64_t nd = a->g_cost[u] + g->weight[k];
+            alt_touch(a, v, t);
+            if (a->h_cost[v] == DIST_INF || nd >= a->g_cost[v]) continue;
+            a->g_cost[v] = nd;
+            if (radix_push(&h, nd + a->h_cost[v], v) < 0) goto out;
+        }
+    }
+    
+out:
+    radix_free(&h);
+    return result;
+}
+
+// ============== WAYPOINT SOLVER ==============
+// Cheapest src -> dst walk through every waypoint. One SSSP per terminal
+// fills a small distance table D, then a Held-Karp DP over subsets:
+// dp[S][i] = cheapest walk from src covering S and ending at waypoint i.
+// dp[S][*] only reads dp[S - {i}][*], so all masks of one popcount form a
+// layer that is split across the worker pool. Returns DIST_INF if dst
+// cannot be reached that way, -1 if out of memory.
+static inline int64_t sat_add(int64_t a, int64_t b) {
+    return (a == DIST_INF || b == DIST_INF) ? DIST_INF : a + b;
+}
+
+struct waypoint_ctx {
+    int k;
+    const int64_t* D;       // (k + 1) x (k + 1); row k = src, column k = dst
+    int64_t* dp;            // 2^k x k
+    const uint32_t* masks;  // masks of the current layer
+    size_t count;
+};
+
+static void waypoint_layer_worker(int tid, int nthreads, void* arg) {
+    struct waypoint_ctx* c = arg;
+    int k = c->k;
+    size_t begin = c->count * (size_t)tid / (size_t)nthreads;
+    size_t end = c->count * (size_t)(tid + 1) / (size_t)nthreads;
+    
+    for (size_t m = begin; m < end; m++) {
+        uint32_t mask = c->masks[m];
+        for (int i = 0; i < k; i++) {
+            if (!(mask & (1u << i))) continue;
+            uint32_t prev = mask ^ (1u << i);
+            int64_t best = DIST_INF;
+            if (prev == 0) {
+                best = c->D[k * (k + 1) + i];
+            } else {
+                for (int j = 0; j < k; j++) {
+                    if (!(prev & (1u << j))) continue;
+                    int64_t cand = sat_add(c->dp[(size_t)prev * k + j], c->D[j * (k + 1) + i]);
+                    if (cand < best) best = cand;
+                }
+            }
+            c->dp[(size_t)mask * k + i] = best;
+        }
+    }
+}
+
+static int64_t solve_waypoints(const struct csr_graph* g, const struct path_constraints* pc,
+                               int32_t src, int32_t dst) {
+    int k = pc ? pc->num_waypoints : 0;
+    int64_t result = -1;
+    int64_t* dist = malloc((size_t)g->n * sizeof(int64_t));
+    int64_t* D = malloc((size_t)(k + 1) * (k + 1) * sizeof(int64_t));
+    int64_t* dp = k ? malloc(((size_t)1 << k) * k * sizeof(int64_t)) : NULL;
+    uint32_t* masks = k ? malloc(((size_t)1 << k) * sizeof(uint32_t)) : NULL;
+    if (!dist || !D || (k && (!dp || !masks))) goto out;
+    
+    // Terminal table: rows are waypoints then src, columns waypoints then dst
+    for (int r = 0; r <= k; r++) {
+        int32_t from = r < k ? pc->waypoint_list[r] : src;
+        if (sssp_run(g, from, pc, dist, NULL) < 0) goto out;
+        for (int c = 0; c <= k; c++) {
+            D[r * (k + 1) + c] = dist[c < k ? pc->waypoint_list[c] : dst];
+        }
+    }
+    if (k == 0) {
+        result = D[0];
+        goto out;
+    }
+    
+    // Masks grouped by popcount (counting sort), one layer per pool_run
+    size_t full = ((size_t)1 << k) - 1;
+    size_t layer_start[WAYPOINT_MAX + 2] = {0};
+    for (size_t mask = 1; mask <= full; mask++) {
+        layer_start[__builtin_popcount((unsigned)mask) + 1]++;
+    }
+    for (int l = 1; l <= k + 1; l++) layer_start[l] += layer_start[l - 1];
+    size_t fill[WAYPOINT_MAX + 1];
+    memcpy(fill, layer_start, sizeof(fill));
+    for (size_t mask = 1; mask <= full; mask++) {
+        masks[fill[__builtin_popcount((unsigned)mask)]++] = (uint32_t)mask;
+    }
+    
+    struct worker_pool pool;
+    if (pool_init(&pool, sssp_threads) < 0) goto out;
+    struct waypoint_ctx c = { k, D, dp, NULL, 0 };
+    for (int l = 1; l <= k; l++) {
+        c.masks = masks + layer_start[l];
+        c.count = layer_start[l + 1] - layer_start[l];
+        pool_run(&pool, waypoint_layer_worker, &c);
+    }
+    pool_destroy(&pool);
+    
+    result = DIST_INF;
+    for (int i = 0; i < k; i++) {
+        int64_t cand = sat_add(dp[full * k + i], D[i * (k + 1) + k]);
+        if (cand < result) result = cand;
+    }
+    
+out:
+    free(dist);
+    free(D);
+    free(dp);
+    free(masks);
+    return result;
+}
+
+// ============== ALL-PAIRS SHORTEST PATHS (blocked Floyd-Warshall) ==============
+// For dense instances one n x n min-plus closure answers every endpoint
+// pair. The matrix is padded to whole APSP_TILE x APSP_TILE tiles and
+// processed one diagonal tile at a time: the diagonal tile, then its tile
+// row and column, then every other tile (split across the worker pool by
+// tile row). Each tile update is C = min(C, A (+) B) with the inner loop
+// over a contiguous row segment, in AVX2 min/add lanes when available.
+// int16 entries (saturating adds, INF = INT16_MAX) are used whenever the
+// longest possible simple path fits, int32 (INF = INT32_MAX / 2) otherwise.
+#define APSP_TILE 64
+#define APSP_MAX_NODES 8192
+#define APSP_INF16 INT16_MAX
+#define APSP_INF32 (INT32_MAX / 2)
 
-// Original weights (will be encrypted at init)
-static const int original_weights[NUM_NODES][NUM_NODES] = {
-    //   0   1   2   3   4   5   6   7   8   9
-    {   0,  4,  2,  0,  0,  0,  0,  0,  0,  0 },  // 0
-    {   4,  0,  3,  5,  0,  0,  0,  0,  0,  0 },  // 1
-    {   2,  3,  0,  1,  6,  0,  0,  0,  0,  0 },  // 2 (FORBIDDEN)
-    {   0,  5,  1,  0,  2,  7,  0,  0,  0,  0 },  // 3
-    {   0,  0,  6,  2,  0,  3,  4,  0,  0,  0 },  // 4
-    {   0,  0,  0,  7,  3,  0,  2,  5,  0,  0 },  // 5
-    {   0,  0,  0,  0,  4,  2,  0,  3,  6,  0 },  // 6
-    {   0,  0,  0,  0,  0,  5,  3,  0,  2,  8 },  // 7 (FORBIDDEN)
-    {   0,  0,  0,  0,  0,  0,  6,  2,  0,  3 },  // 8
-    {   0,  0,  0,  0,  0,  0,  0,  8,  3,  0 }   // 9
+struct apsp_matrix {
+    int32_t n;
+    size_t ld;      // padded row length, multiple of APSP_TILE
+    int wide;       // 0 = int16 entries, 1 = int32 entries
+    void* d;
 };
 
-// Decrypted weights (at runtime)
-static int adj[NUM_NODES][NUM_NODES];
-
-// ============== HIDDEN CONSTRAINTS ==============
-// Forbidden nodes - NOT displayed to user
-// Must be discovered via reverse engineering
-__attribute__((section(".constraints")))
-static const int forbidden_nodes[] = {2, 7, -1};
+// Scalar tile kernels, one per entry type
+#define DEFINE_APSP_TILE_SCALAR(T, SUFFIX, INF)                                      \
+static void apsp_tile_scalar_##SUFFIX(T* c, const T* a, const T* b, size_t ld) {     \
+    for (int k = 0; k < APSP_TILE; k++) {                                           \
+        const T* bk = b + (size_t)k * ld;                                           \
+        for (int i = 0; i < APSP_TILE; i++) {                                       \
+            T aik = a[(size_t)i * ld + k];                                          \
+            if (aik >= (INF)) continue;                                             \
+            T* ci = c + (size_t)i * ld;                                             \
+            for (int j = 0; j < APSP_TILE; j++) {                                   \
+                int64_t sum = (int64_t)aik + bk[j];                                 \
+                T cand = sum >= (INF) ? (INF) : (T)sum;                             \
+                if (cand < ci[j]) ci[j] = cand;                                     \
+            }                                                                       \
+        }                                                                           \
+    }                                                                               \
+}
 
-// ============== UNLOCK STATE ==============
-static int is_unlocked = 0;
+DEFINE_APSP_TILE_SCALAR(int16_t, 16, APSP_INF16)
+DEFINE_APSP_TILE_SCALAR(int32_t, 32, APSP_INF32)
 
-// ============== RED HERRING: Fake key check ==============
-__attribute__((used))
-int check_admin_key(const char* key) {
-    // This does nothing useful
-    return strcmp(key, "DEADBEEF") == 0;
+#ifdef HAVE_X86_SIMD
+__attribute__((target("avx2")))
+static void apsp_tile_avx2_16(int16_t* c, const int16_t* a, const int16_t* b, size_t ld) {
+    for (int k = 0; k < APSP_TILE; k++) {
+        const int16_t* bk = b + (size_t)k * ld;
+        for (int i = 0; i < APSP_TILE; i++) {
+            int16_t aik = a[(size_t)i * ld + k];
+            if (aik == APSP_INF16) continue;
+            __m256i av = _mm256_set1_epi16(aik);
+            int16_t* ci = c + (size_t)i * ld;
+            for (int j = 0; j < APSP_TILE; j += 16) {
+                __m256i bv = _mm256_loadu_si256((const __m256i*)(bk + j));
+                __m256i cv = _mm256_loadu_si256((const __m256i*)(ci + j));
+                cv = _mm256_min_epi16(cv, _mm256_adds_epi16(av, bv));
+                _mm256_storeu_si256((__m256i*)(ci + j), cv);
+            }
+        }
+    }
 }
 
-// ============== REAL: Unlock verification (obfuscated) ==============
-static int verify_unlock(const char* key) {
-    // Deobfuscate and compare at runtime
-    for (size_t i = 0; obf_unlock[i]; i++) {
-        if ((uint8_t)key[i] != (obf_unlock[i] ^ OBFUSCATION_KEY)) {
-            return 0;
+// Both operands are <= INF32 = INT32_MAX / 2, so the sum cannot overflow
+// and min() against C (also <= INF32) keeps every entry <= INF32
+__attribute__((target("avx2")))
+static void apsp_tile_avx2_32(int32_t* c, const int32_t* a, const int32_t* b, size_t ld) {
+    for (int k = 0; k < APSP_TILE; k++) {
+        const int32_t* bk = b + (size_t)k * ld;
+        for (int i = 0; i < APSP_TILE; i++) {
+            int32_t aik = a[(size_t)i * ld + k];
+            if (aik >= APSP_INF32) continue;
+            __m256i av = _mm256_set1_epi32(aik);
+            int32_t* ci = c + (size_t)i * ld;
+            for (int j = 0; j < APSP_TILE; j += 8) {
+                __m256i bv = _mm256_loadu_si256((const __m256i*)(bk + j));
+                __m256i cv = _mm256_loadu_si256((const __m256i*)(ci + j));
+                cv = _mm256_min_epi32(cv, _mm256_add_epi32(av, bv));
+                _mm256_storeu_si256((__m256i*)(ci + j), cv);
+            }
         }
     }
-    return key[6] == '\0';  // Ensure same length
 }
+#endif
 
-// ============== REAL: Derive XOR key from unlock key ==============
-static uint8_t derive_graph_key(const char* unlock) {
-    uint8_t key = 0;
-    for (size_t i = 0; unlock[i]; i++) {
-        key ^= (uint8_t)unlock[i];
+static int apsp_use_avx2(void) {
+#ifdef HAVE_X86_SIMD
+    return __builtin_cpu_supports("avx2");
+#else
+    return 0;
+#endif
+}
+
+struct apsp_ctx {
+    struct apsp_matrix* m;
+    size_t tiles;       // tiles per row
+    size_t kb;          // current diagonal tile
+    int phase;          // 2 = tile row/column of kb, 3 = everything else
+    int avx2;
+};
+
+static void apsp_tile(const struct apsp_ctx* c, size_t ti, size_t tj, size_t ai, size_t aj,
+                      size_t bi, size_t bj) {
+    size_t ld = c->m->ld, T = APSP_TILE;
+    if (c->m->wide) {
+        int32_t* d = c->m->d;
+        int32_t* C = d + ti * T * ld + tj * T;
+        const int32_t* A = d + ai * T * ld + aj * T;
+        const int32_t* B = d + bi * T * ld + bj * T;
+#ifdef HAVE_X86_SIMD
+        if (c->avx2) { apsp_tile_avx2_32(C, A, B, ld); return; }
+#endif
+        apsp_tile_scalar_32(C, A, B, ld);
+    } else {
+        int16_t* d = c->m->d;
+        int16_t* C = d + ti * T * ld + tj * T;
+        const int16_t* A = d + ai * T * ld + aj * T;
+        const int16_t* B = d + bi * T * ld + bj * T;
+#ifdef HAVE_X86_SIMD
+        if (c->avx2) { apsp_tile_avx2_16(C, A, B, ld); return; }
+#endif
+        apsp_tile_scalar_16(C, A, B, ld);
     }
-    return key;  // GRAPHKEY XOR = 'G'^'R'^'A'^'P'^'H'^'K'^'E'^'Y' = 0x1E
 }
 
-// ============== REAL: Decrypt weights ==============
-static void decrypt_weights(const char* unlock) {
-    if (weights_decrypted) return;
+static void apsp_phase_worker(int tid, int nthreads, void* arg) {
+    const struct apsp_ctx* c = arg;
+    size_t kb = c->kb, n = c->tiles;
     
-    uint8_t key = derive_graph_key(unlock);
-    
-    for (int i = 0; i < NUM_NODES; i++) {
-        for (int j = 0; j < NUM_NODES; j++) {
-            // Simple XOR - in real challenge would be more complex
-            adj[i][j] = original_weights[i][j];  // For now, just copy
+    if (c->phase == 2) {
+        // Tile row kb and tile column kb, 2 * (n - 1) independent tiles
+        for (size_t t = (size_t)tid; t < 2 * n; t += (size_t)nthreads) {
+            size_t x = t % n;
+            if (x == kb) continue;
+            if (t < n) apsp_tile(c, kb, x, kb, kb, kb, x);
+            else apsp_tile(c, x, kb, x, kb, kb, kb);
         }
+        return;
     }
     
-    weights_decrypted = 1;
+    for (size_t i = (size_t)tid; i < n; i += (size_t)nthreads) {
+        if (i == kb) continue;
+        for (size_t j = 0; j < n; j++) {
+            if (j != kb) apsp_tile(c, i, j, i, kb, kb, j);
+        }
+    }
 }
 
-// ============== CONSTRAINT CHECK (obfuscated) ==============
-static int is_forbidden(int node) {
-    // Obfuscated check - player must reverse this
-    int check = node ^ 0x05;  // 2 ^ 5 = 7, 7 ^ 5 = 2
-    return (check == 7 || check == 2);
+static void apsp_free(struct apsp_matrix* m) {
+    free(m->d);
+    memset(m, 0, sizeof(*m));
 }
 
-// ============== PATH VERIFICATION ==============
-static int verify_path(const char* path_str, int* cost) {
-    int nodes[NUM_NODES + 1];
-    int count = 0;
+static int apsp_build(struct apsp_matrix* m, const struct csr_graph* g,
+                      const struct path_constraints* pc, int nthreads) {
+    apsp_free(m);
+    if (g->n > APSP_MAX_NODES) return -1;
     
-    // Parse comma-separated nodes
-    char* copy = strdup(path_str);
-    char* token = strtok(copy, ",");
-    while (token && count <= NUM_NODES) {
-        nodes[count++] = atoi(token);
-        token = strtok(NULL, ",");
+    int32_t max_w = 0;
+    for (int64_t k = 0; k < g->m; k++) {
+        if (g->weight[k] > max_w) max_w = g->weight[k];
     }
-    free(copy);
+    m->n = g->n;
+    m->ld = ((size_t)g->n + APSP_TILE - 1) / APSP_TILE * APSP_TILE;
+    if (m->ld == 0) m->ld = APSP_TILE;
+    m->wide = (int64_t)max_w * (g->n > 1 ? g->n - 1 : 1) >= APSP_INF16;
+    size_t elem = m->wide ? sizeof(int32_t) : sizeof(int16_t);
+    m->d = aligned_alloc(64, m->ld * m->ld * elem);
+    if (!m->d) return -1;
     
-    if (count < 2) return -1;
-    if (nodes[0] != 0) return -2;  // Must start at 0
-    if (nodes[count-1] != 9) return -3;  // Must end at 9
+    // Initial matrix: 0 on the diagonal, arc weights, INF elsewhere;
+    // forbidden nodes keep INF rows/columns, forbidden arcs are left out
+    for (size_t i = 0; i < m->ld * m->ld; i++) {
+        if (m->wide) ((int32_t*)m->d)[i] = APSP_INF32;
+        else ((int16_t*)m->d)[i] = APSP_INF16;
+    }
+    for (int32_t u = 0; u < g->n; u++) {
+        if (!node_allowed(pc, u)) continue;
+        size_t row = (size_t)u * m->ld;
+        if (m->wide) ((int32_t*)m->d)[row + u] = 0;
+        else ((int16_t*)m->d)[row + u] = 0;
+        for (int64_t k = g->row_ptr[u]; k < g->row_ptr[u + 1]; k++) {
+            int32_t v = g->col[k];
+            if (!arc_allowed(pc, k, v) || v == u) continue;
+            int32_t w = g->weight[k] < APSP_INF32 ? g->weight[k] : APSP_INF32;
+            if (m->wide) {
+                int32_t* e = (int32_t*)m->d + row + v;
+                if (w < *e) *e = w;
+            } else {
+                int16_t* e = (int16_t*)m->d + row + v;
+                if (w < *e) *e = (int16_t)w;
+            }
+        }
+    }
     
-    *cost = 0;
+    struct worker_pool pool;
+    if (pool_init(&pool, nthreads) < 0) {
+        apsp_free(m);
+        return -1;
+    }
+    struct apsp_ctx c = { m, m->ld / APSP_TILE, 0, 0, apsp_use_avx2() };
+    for (c.kb = 0; c.kb < c.tiles; c.kb++) {
+        apsp_tile(&c, c.kb, c.kb, c.kb, c.kb, c.kb, c.kb);
+        c.phase = 2;
+        pool_run(&pool, apsp_phase_worker, &c);
+        c.phase = 3;
+        pool_run(&pool, apsp_phase_worker, &c);
+    }
+    pool_destroy(&pool);
+    return 0;
+}
+
+static int64_t apsp_distance(const struct apsp_matrix* m, int32_t s, int32_t t) {
+    if (s < 0 || s >= m->n || t < 0 || t >= m->n) return DIST_INF;
+    size_t i = (size_t)s * m->ld + (size_t)t;
+    if (m->wide) {
+        int32_t d = ((const int32_t*)m->d)[i];
+        return d >= APSP_INF32 ? DIST_INF : d;
+    }
+    int16_t d = ((const int16_t*)m->d)[i];
+    return d == APSP_INF16 ? DIST_INF : d;
+}
+
+// Dense enough that one closure beats per-pair searches
+static int graph_is_dense(const struct csr_graph* g) {
+    return g->n <= APSP_MAX_NODES && g->m * 4 >= (int64_t)g->n * g->n;
+}
+
+// ============== DYNAMIC SHORTEST PATHS ==============
+// Weight changes between attempts (congestion rounds) repair the cached
+// tree instead of rebuilding it, Ramalingam-Reps style: every node whose
+// tree path crosses an increased arc is cut loose, the cut region is
+// re-seeded from its unaffected in-neighbours, heads of decreased arcs are
+// seeded from their tails, and one Dijkstra pass settles only the nodes
+// whose distance can change. Child lists mirror pred[] so the affected
+// subtrees are found without scanning the whole graph.
+struct weight_update {
+    int32_t u, v;
+    int32_t w;
+};
+
+struct dyn_sssp {
+    struct csr_graph* g;
+    const struct path_constraints* pc;
+    int64_t* dist;
+    int32_t* pred;
+    struct csr_graph rev;   // in-arcs; weights are read through rev_arc
+    int64_t* rev_arc;       // reverse arc -> forward arc index
+    int32_t* first_child;
+    int32_t* next_sib;
+    int32_t* prev_sib;
+    uint8_t* affected;
+    int32_t* cut;           // nodes cut loose by the current batch
+    uint64_t resettled;     // nodes settled by the last batch
+};
+
+static void dyn_free(struct dyn_sssp* d) {
+    csr_free(&d->rev);
+    free(d->rev_arc);
+    free(d->first_child);
+    free(d->next_sib);
+    free(d->prev_sib);
+    free(d->affected);
+    free(d->cut);
+    memset(d, 0, sizeof(*d));
+}
+
+static void dyn_unlink(struct dyn_sssp* d, int32_t v) {
+    int32_t p = d->pred[v];
+    if (p < 0) return;
+    if (d->prev_sib[v] >= 0) d->next_sib[d->prev_sib[v]] = d->next_sib[v];
+    else d->first_child[p] = d->next_sib[v];
+    if (d->next_sib[v] >= 0) d->prev_sib[d->next_sib[v]] = d->prev_sib[v];
+    d->pred[v] = -1;
+}
+
+static void dyn_link(struct dyn_sssp* d, int32_t v, int32_t p) {
+    dyn_unlink(d, v);
+    d->pred[v] = p;
+    if (p < 0) return;
+    d->prev_sib[v] = -1;
+    d->next_sib[v] = d->first_child[p];
+    if (d->first_child[p] >= 0) d->prev_sib[d->first_child[p]] = v;
+    d->first_child[p] = v;
+}
+
+// Adopts an existing tree (dist/pred from sssp_run); g's weights are
+// updated in place by dyn_apply
+static int dyn_init(struct dyn_sssp* d, struct csr_graph* g, const struct path_constraints* pc,
+                    int64_t* dist, int32_t* pred) {
+    dyn_free(d);
+    size_t n = (size_t)g->n;
+    d->g = g;
+    d->pc = pc;
+    d->dist = dist;
+    d->pred = pred;
+    d->rev_arc = malloc((size_t)(g->m ? g->m : 1) * sizeof(int64_t));
+    d->first_child = malloc(n * sizeof(int32_t));
+    d->next_sib = malloc(n * sizeof(int32_t));
+    d->prev_sib = malloc(n * sizeof(int32_t));
+    d->affected = calloc(n, 1);
+    d->cut = malloc(n * sizeof(int32_t));
+    if (!d->rev_arc || !d->first_child || !d->next_sib || !d->prev_sib || !d->affected ||
+        !d->cut || csr_transpose(g, &d->rev, d->rev_arc) < 0) {
+        dyn_free(d);
+        return -1;
+    }
+    
+    for (size_t v = 0; v < n; v++) d->first_child[v] = -1;
+    for (int32_t v = 0; v < g->n; v++) {
+        int32_t p = pred[v];
+        pred[v] = -1;
+        dyn_link(d, v, p);
+    }
+    return 0;
+}
+
+// Applies a batch of arc weight changes and repairs dist/pred. Updates
+// naming an arc that does not exist are ignored. Returns the number of
+// arcs changed, -1 if out of memory (the tree is then unusable).
+static int dyn_apply(struct dyn_sssp* d, const struct weight_update* ups, int count) {
+    struct csr_graph* g = d->g;
+    int64_t* dist = d->dist;
+    int changed = 0;
+    int32_t ncut = 0;
+    d->resettled = 0;
+    
+    // Set the new weights; cut the subtree below every increased tree arc
     for (int i = 0; i < count; i++) {
-        // Check forbidden
-        if (is_forbidden(nodes[i])) {
-            return -4;  // Forbidden node used
-        }
+        int64_t k = csr_arc_index(g, ups[i].u, ups[i].v);
+        if (k < 0 || g->weight[k] == ups[i].w) continue;
+        int32_t u = ups[i].u, v = ups[i].v;
+        int32_t old = g->weight[k];
+        g->weight[k] = ups[i].w;
+        changed++;
         
-        // Calculate cost
-        if (i > 0) {
-            int from = nodes[i-1];
-            int to = nodes[i];
-            if (from < 0 || from >= NUM_NODES || to < 0 || to >= NUM_NODES) {
-                return -5;
+        // A tree arc that no longer supports dist[v]; comparing against the
+        // support value rather than old == support also catches an arc
+        // listed twice in one batch
+        if (d->pred[v] != u || d->affected[v] || dist[u] + old > dist[v] ||
+            dist[u] + ups[i].w <= dist[v]) {
+            continue;
+        }
+        int32_t head = ncut;
+        d->cut[ncut++] = v;
+        d->affected[v] = 1;
+        while (head < ncut) {
+            int32_t x = d->cut[head++];
+            for (int32_t c = d->first_child[x]; c >= 0; c = d->next_sib[c]) {
+                if (!d->affected[c]) {
+                    d->affected[c] = 1;
+                    d->cut[ncut++] = c;
+                }
+            }
+        }
+    }
+    
+    for (int32_t i = 0; i < ncut; i++) {
+        dist[d->cut[i]] = DIST_INF;
+        dyn_unlink(d, d->cut[i]);
+    }
+    
+    struct radix_heap h = {0};
+    int rc = 0;
+    
+    // Cut nodes restart from their best unaffected in-neighbour
+    for (int32_t i = 0; i < ncut && rc == 0; i++) {
+        int32_t x = d->cut[i];
+        if (!node_allowed(d->pc, x)) continue;
+        int64_t best = DIST_INF;
+        int32_t from = -1;
+        for (int64_t j = d->rev.row_ptr[x]; j < d->rev.row_ptr[x + 1]; j++) {
+            int32_t p = d->rev.col[j];
+            int64_t k = d->rev_arc[j];
+            if (d->affected[p] || dist[p] == DIST_INF || !arc_allowed(d->pc, k, x)) continue;
+            if (dist[p] + g->weight[k] < best) {
+                best = dist[p] + g->weight[k];
+                from = p;
             }
-            if (adj[from][to] == 0) {
-                return -6;  // No edge
+        }
+        if (from >= 0) {
+            dist[x] = best;
+            dyn_link(d, x, from);
+            rc = radix_push(&h, best, x);
+        }
+    }
+    for (int32_t i = 0; i < ncut; i++) d->affected[d->cut[i]] = 0;
+    
+    // Decreased arcs out of settled nodes may shortcut their heads
+    for (int i = 0; i < count && rc == 0; i++) {
+        int32_t u = ups[i].u, v = ups[i].v;
+        int64_t k = csr_arc_index(g, u, v);
+        if (k < 0 || dist[u] == DIST_INF || !arc_allowed(d->pc, k, v)) continue;
+        if (dist[u] + g->weight[k] < dist[v]) {
+            dist[v] = dist[u] + g->weight[k];
+            dyn_link(d, v, u);
+            rc = radix_push(&h, dist[v], v);
+        }
+    }
+    
+    // Every seed is queued before the first pop, so keys stay monotone
+    while (h.size > 0 && rc == 0) {
+        struct heap_entry top = radix_pop(&h);
+        int32_t u = top.node;
+        if (top.key > dist[u]) continue;  // stale
+        d->resettled++;
+        
+        for (int64_t k = g->row_ptr[u]; k < g->row_ptr[u + 1]; k++) {
+            int32_t v = g->col[k];
+            if (!arc_allowed(d->pc, k, v)) continue;
+            int64_t nd = top.key + g->weight[k];
+            if (nd < dist[v]) {
+                dist[v] = nd;
+                dyn_link(d, v, u);
+                if (radix_push(&h, nd, v) < 0) rc = -1;
             }
-            *cost += adj[from][to];
         }
     }
     
-    return 1;
+    radix_free(&h);
+    return rc < 0 ? -1 : changed;
 }
 
 // ============== OPTIMAL PATH CALCULATION ==============
-static int find_optimal(void) {
+// Graph and constraints are fixed once decrypt_weights has run, so the
+// shortest-path tree from the route source (and the waypoint optimum, if there
+// are waypoints) is built once at unlock and every later attempt is a
+// table lookup. Like the graph, the tree is shared read-only by every
+// session.
+static int64_t* spt_dist;
+static int32_t* spt_pred;
+static int64_t waypoint_optimum = DIST_INF;
+
+static int build_path_cache(void) {
+    if (spt_dist) return 0;
+    
     // Dijkstra avoiding forbidden nodes
-    int dist[NUM_NODES];
-    int visited[NUM_NODES];
+    int64_t* dist = malloc((size_t)graph.n * sizeof(int64_t));
+    int32_t* pred = malloc((size_t)graph.n * sizeof(int32_t));
+    if (!dist || !pred || sssp_run(&graph, route_src, &constraints, dist, pred) < 0) {
+        free(dist);
+        free(pred);
+        return -1;
+    }
+    spt_dist = dist;
+    spt_pred = pred;
+    
+    if (constraints.num_waypoints > 0) {
+        waypoint_optimum = solve_waypoints(&graph, &constraints, route_src, route_dst);
+        if (waypoint_optimum < 0) return -1;
+    }
+    return 0;
+}
+
+// ============== SESSIONS ==============
+// Everything one player can change. The graph, constraints and tree above
+// are written once at unlock and only read afterwards, so sessions on any
+// number of threads share them without copies. A session's first
+// congestion round gives it private weights (copy on write: the CSR
+// structure stays shared), its own tree and the state to repair it.
+struct path_session {
+    const struct csr_graph* graph;  // &graph, or &congested
+    const int64_t* dist;            // tree from route_src in *graph
+    const int32_t* pred;
+    int64_t waypoint_optimum;
+    struct csr_graph congested;     // row_ptr and col alias graph's
+    struct dyn_sssp dyn;            // owns congested tree's dist and pred
+    int round;                      // next congestion round
+    int unlocked;
+    char correct_answer[64];
+};
+
+// Requires the shared tree (build_path_cache)
+static void session_init(struct path_session* s) {
+    memset(s, 0, sizeof(*s));
+    s->graph = &graph;
+    s->dist = spt_dist;
+    s->pred = spt_pred;
+    s->waypoint_optimum = waypoint_optimum;
+}
+
+static void session_free(struct path_session* s) {
+    if (s->congested.weight) {
+        free(s->dyn.dist);
+        free(s->dyn.pred);
+        dyn_free(&s->dyn);
+        free(s->congested.weight);
+    }
+    memset(s, 0, sizeof(*s));
+}
+
+// Copies the weights and tree a session is about to change
+static int session_own_weights(struct path_session* s) {
+    if (s->congested.weight) return 0;
+    size_t n = (size_t)graph.n;
+    struct csr_graph* c = &s->congested;
+    int32_t* weight = malloc((size_t)(graph.m ? graph.m : 1) * sizeof(int32_t));
+    int64_t* dist = malloc(n * sizeof(int64_t));
+    int32_t* pred = malloc(n * sizeof(int32_t));
+    if (!weight || !dist || !pred) {
+        free(weight);
+        free(dist);
+        free(pred);
+        return -1;
+    }
+    memcpy(weight, graph.weight, (size_t)graph.m * sizeof(int32_t));
+    memcpy(dist, spt_dist, n * sizeof(int64_t));
+    memcpy(pred, spt_pred, n * sizeof(int32_t));
+    c->n = graph.n;
+    c->m = graph.m;
+    c->row_ptr = graph.row_ptr;
+    c->col = graph.col;
+    c->weight = weight;
+    if (dyn_init(&s->dyn, c, &constraints, dist, pred) < 0) {
+        free(weight);
+        free(dist);
+        free(pred);
+        memset(c, 0, sizeof(*c));
+        return -1;
+    }
+    s->graph = c;
+    s->dist = dist;
+    s->pred = pred;
+    return 0;
+}
+
+static int64_t find_optimal(const struct path_session* s) {
+    if (constraints.num_waypoints > 0) return s->waypoint_optimum;
+    return s->dist[route_dst];
+}
+
+// ============== CONGESTION EVENTS ==============
+// Congestion is scripted by the operator, never by the player: the file
+// named by PATHFINDER_ROUNDS holds one round per line, "u v w [u v w ...]"
+// setting both directions of each listed edge to w ('#' starts a comment).
+// Rounds are parsed once and shared read-only; each session steps to its
+// next round after every attempt that does not win. The session's tree is
+// repaired in place and its waypoint optimum solved again.
+#define ROUNDS_ENV "PATHFINDER_ROUNDS"
+#define CONGEST_MAX 64
+
+struct congestion_round {
+    struct weight_update ups[2 * CONGEST_MAX];
+    int count;
+};
+
+static struct congestion_round* congestion_rounds;
+static int num_congestion_rounds;
+
+// Applies the session's next round, if any; 1 if one was applied
+static int session_next_round(struct path_session* s) {
+    if (s->round >= num_congestion_rounds) return 0;
+    const struct congestion_round* r = &congestion_rounds[s->round++];
     
-    for (int i = 0; i < NUM_NODES; i++) {
-        dist[i] = 9999;
-        visited[i] = 0;
+    int changed = session_own_weights(s) < 0 ? -1 : dyn_apply(&s->dyn, r->ups, r->count);
+    if (changed > 0 && constraints.num_waypoints > 0) {
+        s->waypoint_optimum = solve_waypoints(s->graph, &constraints, route_src, route_dst);
+    }
+    if (changed < 0 || s->waypoint_optimum < 0) {
+        fprintf(stderr, "Out of memory.\n");
+        exit(1);
+    }
+    return 1;
+}
+
+// XOR of the bytes of the tree route to route_dst written as an answer
+// ("0,1,3,..."): what a winning answer contributes to the flag key
+static uint8_t tree_route_fold(const int32_t* pred) {
+    uint8_t fold = 0;
+    char num[16];
+    for (int32_t v = route_dst; v >= 0; v = pred[v]) {
+        int len = snprintf(num, sizeof(num), "%d", v);
+        for (int i = 0; i < len; i++) fold ^= (uint8_t)num[i];
+        if (v != route_dst) fold ^= ',';
+    }
+    return fold;
+}
+
+// The flag is keyed by the winning answer, so a round may move the
+// optimum only to a route with the same fold; replays every round once
+// on a scratch session and exits on the first that breaks this
+static void check_congestion_rounds(const char* path) {
+    if (num_congestion_rounds == 0 || spt_dist[route_dst] == DIST_INF) return;
+    if (constraints.num_waypoints > 0) {
+        fprintf(stderr, "Round file %s: congestion needs a graph without waypoints.\n", path);
+        exit(1);
+    }
+    uint8_t fold = tree_route_fold(spt_pred);
+    struct path_session s;
+    session_init(&s);
+    for (int i = 0; i < num_congestion_rounds; i++) {
+        session_next_round(&s);
+        if (s.dist[route_dst] != DIST_INF && tree_route_fold(s.pred) != fold) {
+            fprintf(stderr, "Round file %s: round %d moves the optimum to a route with another "
+                    "flag key.\n", path, i + 1);
+            exit(1);
+        }
+    }
+    session_free(&s);
+}
+
+// Requires build_path_cache; exits on a malformed or key-changing file
+static void load_congestion_rounds(void) {
+    const char* path = getenv(ROUNDS_ENV);
+    if (!path || congestion_rounds) return;
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "Cannot open round file %s.\n", path);
+        exit(1);
     }
-    dist[0] = 0;
     
-    for (int count = 0; count < NUM_NODES - 1; count++) {
-        int min_dist = 9999, u = -1;
-        for (int v = 0; v < NUM_NODES; v++) {
-            if (!visited[v] && !is_forbidden(v) && dist[v] < min_dist) {
-                min_dist = dist[v];
-                u = v;
+    char* line = NULL;
+    size_t cap = 0;
+    int lineno = 0;
+    while (getline(&line, &cap, f) > 0) {
+        lineno++;
+        line[strcspn(line, "#\n")] = 0;
+        struct congestion_round r = { .count = 0 };
+        const char* p = line;
+        int u, v, w, used;
+        while (sscanf(p, "%d %d %d%n", &u, &v, &w, &used) == 3) {
+            p += used;
+            if (r.count == 2 * CONGEST_MAX || u < 0 || u >= graph.n || v < 0 || v >= graph.n ||
+                w <= 0 || w > 1000000) {
+                fprintf(stderr, "Round file %s line %d: bad update %d %d %d.\n", path, lineno, u, v, w);
+                exit(1);
             }
+            r.ups[r.count++] = (struct weight_update){ u, v, w };
+            r.ups[r.count++] = (struct weight_update){ v, u, w };
         }
-        if (u == -1) break;
-        visited[u] = 1;
+        if (p[strspn(p, " \t\r")] != 0) {
+            fprintf(stderr, "Round file %s line %d: expected \"u v w\" triples.\n", path, lineno);
+            exit(1);
+        }
+        if (r.count == 0) continue;
         
-        for (int v = 0; v < NUM_NODES; v++) {
-            if (!visited[v] && !is_forbidden(v) && adj[u][v] > 0) {
-                if (dist[u] + adj[u][v] < dist[v]) {
-                    dist[v] = dist[u] + adj[u][v];
-                }
-            }
+        struct congestion_round* grown = realloc(congestion_rounds,
+                                                 (size_t)(num_congestion_rounds + 1) * sizeof(r));
+        if (!grown) {
+            fprintf(stderr, "Out of memory.\n");
+            exit(1);
+        }
+        congestion_rounds = grown;
+        congestion_rounds[num_congestion_rounds++] = r;
+    }
+    free(line);
+    fclose(f);
+    check_congestion_rounds(path);
+}
+
+// ============== ROUTE CHECK (arbitrary endpoints) ==============
+// Same validation as verify_path, optimality from the all-pairs matrix on
+// dense graphs, an ALT query otherwise, or the waypoint solver when there
+// are waypoints. Routes are checked only from the --route command line,
+// once per run, so the matrix or the landmarks are built for that one
+// query, and only after the route itself has passed.
+static int check_route(const struct csr_graph* g, int32_t src, int32_t dst, const char* path_str) {
+    int64_t cost;
+    int result = verify_route(g, path_str, src, dst, &cost);
+    if (result != 1) {
+        printf("Invalid route (error %d).\n", result);
+        return 1;
+    }
+    
+    int64_t optimal = -1;
+    struct apsp_matrix m = {0};
+    struct alt_index a = {0};
+    if (constraints.num_waypoints > 0) {
+        optimal = solve_waypoints(g, &constraints, src, dst);
+    } else if (graph_is_dense(g) && apsp_build(&m, g, &constraints, sssp_threads) == 0) {
+        optimal = apsp_distance(&m, src, dst);
+    } else if (alt_prepare(&a, g, &constraints, route_src, ALT_DEFAULT_LANDMARKS) == 0) {
+        optimal = alt_query(&a, src, dst);
+    }
+    apsp_free(&m);
+    alt_free(&a);
+    if (optimal < 0) {
+        printf("Out of memory.\n");
+        return 1;
+    }
+    if (cost == optimal) {
+        printf("Route verified: cost %lld (OPTIMAL)\n", (long long)cost);
+        return 0;
+    }
+    printf("Valid route, cost %lld, but not optimal (%lld).\n", (long long)cost, (long long)optimal);
+    return 1;
+}
+
+// ============== BULK SSSP MODE ==============
+// pathfinder --sssp <arc_file> <src> [dst [w1,w2,...]]: arc file as for
+// load_arc_file. Reports reach and timing; with dst, also prints the tree
+// path to dst, preprocesses landmarks and runs one ALT query; with
+// waypoints, also solves the must-visit route.
+static int run_sssp_file(const char* path, int32_t src, int32_t dst, const char* waypoints) {
+    struct timespec t0, t1, t2;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    
+    struct csr_graph g = {0};
+    if (load_arc_file(path, &g) < 0) return 1;
+    int has_dst = dst >= 0 && dst < g.n;
+    int64_t* dist = malloc((size_t)g.n * sizeof(int64_t));
+    int32_t* pred = has_dst ? malloc((size_t)g.n * sizeof(int32_t)) : NULL;
+    if (!dist || (has_dst && !pred)) {
+        printf("Out of memory.\n");
+        free(dist);
+        free(pred);
+        csr_free(&g);
+        return 1;
+    }
+    
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    if (sssp_run(&g, src, NULL, dist, pred) < 0) {
+        printf("Out of memory.\n");
+        free(dist);
+        free(pred);
+        csr_free(&g);
+        return 1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t2);
+    
+    int64_t reached = 0, farthest = 0;
+    uint64_t checksum = 0;
+    for (int32_t v = 0; v < g.n; v++) {
+        if (dist[v] == DIST_INF) continue;
+        reached++;
+        if (dist[v] > farthest) farthest = dist[v];
+        checksum = checksum * 1099511628211ULL ^ (uint64_t)dist[v];
+    }
+    
+    double build_ms = (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) / 1e6;
+    double solve_ms = (t2.tv_sec - t1.tv_sec) * 1e3 + (t2.tv_nsec - t1.tv_nsec) / 1e6;
+    printf("Nodes: %d  Arcs: %lld  Reached: %lld  Farthest: %lld\n",
+           g.n, (long long)g.m, (long long)reached, (long long)farthest);
+    printf("Checksum: %016llx\n", (unsigned long long)checksum);
+    printf("Engine: %s (%d threads)\n", sssp_engine == ENGINE_DELTA ? "delta-stepping" : "dijkstra",
+           sssp_engine == ENGINE_DELTA ? sssp_threads : 1);
+    printf("%s: %.1f ms  SSSP: %.1f ms\n", g.file.base ? "Graph map" : "CSR build", build_ms, solve_ms);
+    
+    if (has_dst) {
+        // Walk the tree back from dst; more than n hops means a cycle
+        int32_t hops = 0, v = dst;
+        while (v != src && v >= 0 && hops <= g.n) {
+            v = pred[v];
+            hops++;
+        }
+        if (dist[dst] == DIST_INF) {
+            printf("Path: none\n");
+        } else if (v != src) {
+            printf("Path: broken predecessor tree at %d\n", dst);
+        } else {
+            int32_t* path = malloc(((size_t)hops + 1) * sizeof(int32_t));
+            for (int32_t i = hops, u = dst; path && i >= 0; i--, u = pred[u]) path[i] = u;
+            printf("Path:");
+            for (int32_t i = 0; path && i <= hops; i++) printf(" %d", path[i]);
+            printf(" (cost %lld)\n", (long long)dist[dst]);
+            free(path);
+        }
+        
+        struct alt_index a = {0};
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        if (alt_prepare(&a, &g, NULL, src, ALT_DEFAULT_LANDMARKS) == 0) {
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            int64_t d = alt_query(&a, src, dst);
+            clock_gettime(CLOCK_MONOTONIC, &t2);
+            printf("ALT: %d landmarks in %.1f ms; d(%d,%d) = %lld (SSSP %lld), "
+                   "%llu settled, %.3f ms\n",
+                   a.k, (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) / 1e6,
+                   src, dst, (long long)d, (long long)dist[dst], (unsigned long long)a.settled,
+                   (t2.tv_sec - t1.tv_sec) * 1e3 + (t2.tv_nsec - t1.tv_nsec) / 1e6);
+        }
+        alt_free(&a);
+    }
+    
+    struct path_constraints pc;
+    if (has_dst && waypoints && constraints_init(&pc, &g) == 0) {
+        for (const char* p = waypoints; *p; ) {
+            long w = strtol(p, (char**)&p, 10);
+            if (w >= 0 && w < g.n && add_waypoint(&pc, (int32_t)w) < 0) break;
+            if (*p) p++;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        int64_t d = solve_waypoints(&g, &pc, src, dst);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        if (d < 0) {
+            printf("Waypoints: %d; out of memory\n", pc.num_waypoints);
+        } else {
+            printf("Waypoints: %d; cost %lld, %.1f ms\n", pc.num_waypoints, (long long)d,
+                   (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) / 1e6);
         }
+        constraints_free(&pc);
     }
     
-    return dist[9];
+    free(dist);
+    free(pred);
+    csr_free(&g);
+    return 0;
 }
 
 // ============== FLAG DERIVATION ==============
 // Key depends on BOTH magic bytes AND correct answer
-static char correct_answer[64] = {0};
+
+// Encrypted by the compiler: magic marker fold XOR answer (0x31)
+#define FLAG_TEXT "L3m0nCTF{p4th_SEED_B_c4f3b1}"
+#define FLAG_KEY (TRILOGY_FOLD_MAGIC(MAGIC_TEXT) ^ 0x31)
+#define FLAG_LEN (sizeof(FLAG_TEXT) - 1)
+
+_Static_assert(TRILOGY_STRING_FITS(FLAG_TEXT), "flag too long");
+static const uint8_t encoded_flag[TRILOGY_STRING_MAX] = { TRILOGY_XOR_STRING(FLAG_TEXT, FLAG_KEY) };
+
+// Fold of the magic section, taken once at startup
+static uint8_t magic_key;
+
+static void init_magic_key(void) {
+    magic_key = trilogy_fold(__start_trilogy_magic,
+                             (size_t)(__stop_trilogy_magic - __start_trilogy_magic));
+}
 
 static uint8_t derive_flag_key(const char* answer) {
-    uint8_t buffer[32];
-    int fd = open("/proc/self/exe", O_RDONLY);
-    if (fd < 0) return 0x42;
-    lseek(fd, 0x3000, SEEK_SET);
-    read(fd, buffer, 32);
-    close(fd);
-    
-    // XOR magic bytes
-    uint8_t key = 0;
-    for (int i = 0; i < 32; i++) key ^= buffer[i];
+    uint8_t key = magic_key;
     
     // XOR with answer bytes - makes key answer-dependent!
     for (size_t i = 0; answer[i]; i++) {
@@ -217,17 +2088,15 @@ static uint8_t derive_flag_key(const char* answer) {
 }
 
 // ============== FLAG PRINTING ==============
-static void print_flag(void) {
-    // Flag: L3m0nCTF{p4th_SEED_B_c4f3b1}
-    // XOR key = magic (0x40) XOR answer (0x31) = 0x71
-    unsigned char encoded_flag[] = {
-        0x3d, 0x42, 0x1c, 0x41, 0x1f, 0x32, 0x25, 0x37,
-        0x0a, 0x01, 0x45, 0x05, 0x19, 0x2e, 0x22, 0x34,
-        0x34, 0x35, 0x2e, 0x33, 0x2e, 0x12, 0x45, 0x17,
-        0x42, 0x13, 0x40, 0x0c, 0x00
-    };
-    
-    uint8_t key = derive_flag_key(correct_answer);
+// FLAG_LEN bytes, decoded under the key the correct answer derives
+static void decode_flag(const char* answer, char* flag) {
+    // XOR key = magic_bytes XOR answer_bytes
+    trilogy_xor_into(flag, encoded_flag, FLAG_LEN, derive_flag_key(answer));
+}
+
+static void print_flag(const char* answer) {
+    char flag[FLAG_LEN];
+    decode_flag(answer, flag);
     
     printf("\n");
     printf("════════════════════════════════════════════════════\n");
@@ -235,11 +2104,7 @@ static void print_flag(void) {
     printf("════════════════════════════════════════════════════\n");
     printf(" You found the optimal path and avoided the traps.  \n");
     printf("════════════════════════════════════════════════════\n");
-    printf(" FLAG: ");
-    for (size_t i = 0; encoded_flag[i]; i++) {
-        printf("%c", encoded_flag[i] ^ key);
-    }
-    printf("\n");
+    printf(" FLAG: %.*s\n", (int)FLAG_LEN, flag);
     printf("════════════════════════════════════════════════════\n");
 }
 
@@ -277,9 +2142,10 @@ static void display_unlocked(void) {
 __attribute__((used))
 void debug_show_graph(void) {
     printf("DEBUG: Graph weights:\n");
-    for (int i = 0; i < NUM_NODES; i++) {
-        for (int j = 0; j < NUM_NODES; j++) {
-            printf("%2d ", adj[i][j]);
+    for (int32_t u = 0; u < graph.n; u++) {
+        printf("%2d:", u);
+        for (int64_t k = graph.row_ptr[u]; k < graph.row_ptr[u + 1]; k++) {
+            printf(" %d(%d)", graph.col[k], graph.weight[k]);
         }
         printf("\n");
     }
@@ -287,14 +2153,201 @@ void debug_show_graph(void) {
     for (int i = 0; forbidden_nodes[i] != -1; i++) {
         printf("%d ", forbidden_nodes[i]);
     }
-    printf("\nOptimal cost: %d\n", find_optimal());
+    if (!spt_dist) return;
+    printf("\nOptimal cost: %lld\n", (long long)(constraints.num_waypoints > 0
+                                                   ? waypoint_optimum : spt_dist[route_dst]));
+    if (spt_dist[route_dst] == DIST_INF) return;
+    
+    // Walk the cached tree back from the end node
+    printf("Optimal path (reversed):");
+    for (int32_t v = route_dst; v >= 0; v = spt_pred[v]) {
+        printf(" %d", v);
+    }
+    printf("\n");
+}
+
+// ============== APSP MODE ==============
+// pathfinder --apsp <arc_file>: closes the whole matrix and cross-checks
+// the row of node 0 against Dijkstra.
+
+static int run_apsp_file(const char* path) {
+    struct csr_graph g = {0};
+    struct apsp_matrix m = {0};
+    if (load_arc_file(path, &g) < 0) return 1;
+    int rc = 0;
+    if (g.n > APSP_MAX_NODES) {
+        printf("Graph too large for APSP (max %d nodes).\n", APSP_MAX_NODES);
+        csr_free(&g);
+        return 1;
+    }
+    
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    rc = apsp_build(&m, &g, NULL, sssp_threads);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    int64_t* dist = malloc((size_t)g.n * sizeof(int64_t));
+    if (rc < 0 || !dist || sssp_run(&g, 0, NULL, dist, NULL) < 0) {
+        printf("Out of memory.\n");
+        free(dist);
+        apsp_free(&m);
+        csr_free(&g);
+        return 1;
+    }
+    
+    int32_t mismatches = 0;
+    for (int32_t v = 0; v < g.n; v++) mismatches += apsp_distance(&m, 0, v) != dist[v];
+    printf("Nodes: %d  Arcs: %lld  Entries: int%d  Kernel: %s  Threads: %d\n",
+           g.n, (long long)g.m, m.wide ? 32 : 16, apsp_use_avx2() ? "avx2" : "scalar", sssp_threads);
+    printf("APSP: %.1f ms  Row 0 mismatches vs SSSP: %d\n",
+           (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) / 1e6, mismatches);
+    
+    free(dist);
+    apsp_free(&m);
+    csr_free(&g);
+    return mismatches != 0;
+}
+
+// ============== DYNAMIC MODE ==============
+// pathfinder --dynamic <arc_file> <src> <rounds> <batch>: applies rounds of
+// random weight changes (halved to doubled), repairing the tree each time,
+// and checks the result against a full recomputation.
+static int run_dynamic_file(const char* path, int32_t src, int rounds, int batch) {
+    struct csr_graph g = {0};
+    if (load_arc_file(path, &g) < 0) return 1;
+    if (g.m == 0 || src < 0 || src >= g.n || batch <= 0) {
+        printf("Need a source node and a positive batch size.\n");
+        csr_free(&g);
+        return 1;
+    }
+    
+    struct dyn_sssp d = {0};
+    int64_t* dist = malloc((size_t)g.n * sizeof(int64_t));
+    int64_t* check = malloc((size_t)g.n * sizeof(int64_t));
+    int32_t* pred = malloc((size_t)g.n * sizeof(int32_t));
+    struct weight_update* ups = malloc((size_t)batch * sizeof(*ups));
+    int32_t* tails = malloc((size_t)g.m * sizeof(int32_t));
+    if (!dist || !check || !pred || !ups || !tails ||
+        sssp_dijkstra(&g, src, NULL, dist, pred) < 0 || dyn_init(&d, &g, NULL, dist, pred) < 0) {
+        printf("Out of memory.\n");
+        rounds = -1;
+    }
+    for (int32_t u = 0; rounds >= 0 && u < g.n; u++) {
+        for (int64_t k = g.row_ptr[u]; k < g.row_ptr[u + 1]; k++) tails[k] = u;
+    }
+    
+    uint64_t rng = 0x9e3779b97f4a7c15ULL, resettled = 0;
+    double dyn_ms = 0, full_ms = 0;
+    int mismatched = 0;
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < batch; i++) {
+            rng ^= rng << 13; rng ^= rng >> 7; rng ^= rng << 17;
+            int64_t k = (int64_t)(rng % (uint64_t)g.m);
+            int32_t w = g.weight[k];
+            w = (rng >> 32) & 1 ? w * 2 : w / 2;
+            ups[i] = (struct weight_update){ tails[k], g.col[k], w > 0 ? w : 1 };
+        }
+        
+        struct timespec t0, t1, t2;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        if (dyn_apply(&d, ups, batch) < 0) {
+            printf("Out of memory.\n");
+            break;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        sssp_dijkstra(&g, src, NULL, check, NULL);
+        clock_gettime(CLOCK_MONOTONIC, &t2);
+        
+        resettled += d.resettled;
+        dyn_ms += (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) / 1e6;
+        full_ms += (t2.tv_sec - t1.tv_sec) * 1e3 + (t2.tv_nsec - t1.tv_nsec) / 1e6;
+        mismatched += memcmp(dist, check, (size_t)g.n * sizeof(int64_t)) != 0;
+    }
+    
+    if (rounds > 0) {
+        printf("Nodes: %d  Arcs: %lld  Rounds: %d  Batch: %d\n", g.n, (long long)g.m, rounds, batch);
+        printf("Re-settled per round: %.1f (%.3f%% of nodes)\n", (double)resettled / rounds,
+               100.0 * resettled / rounds / g.n);
+        printf("Repair: %.3f ms/round  Full Dijkstra: %.3f ms/round  Mismatched rounds: %d\n",
+               dyn_ms / rounds, full_ms / rounds, mismatched);
+    }
+    
+    dyn_free(&d);
+    free(dist);
+    free(check);
+    free(pred);
+    free(ups);
+    free(tails);
+    csr_free(&g);
+    return mismatched != 0 || rounds < 0;
+}
+
+// ============== PIPE MODE ==============
+// pathfinder <unlock_key> --pipe: one path per line, one record each:
+// "ok <cost> <flag>", "slow <cost>" or "err". Like the interactive
+// loop, a non-optimal path learns only its own cost and an invalid one
+// not even why it failed.
+static void pipe_answer(void* ctx, struct trilogy_reply* r, char* line) {
+    struct path_session* s = ctx;
+    int64_t cost;
+    int result = verify_path(s->graph, line, &cost);
+    int64_t optimal = find_optimal(s);
+    if (result == 1 && cost == optimal) {
+        char flag[FLAG_LEN];
+        strncpy(s->correct_answer, line, 63);
+        decode_flag(s->correct_answer, flag);
+        trilogy_reply_printf(r, "ok %lld ", (long long)cost);
+        trilogy_reply_add(r, flag, FLAG_LEN);
+        trilogy_reply_add(r, "\n", 1);
+        return;
+    }
+    if (result != 1) {
+        trilogy_reply_add(r, "err\n", 4);
+    } else {
+        trilogy_reply_printf(r, "slow %lld\n", (long long)cost);
+    }
+    session_next_round(s);
+}
+
+// ============== SERVE MODE ==============
+// <unlock_key> --serve <port> [workers]: the --pipe protocol over TCP, one
+// session per connection (common/trilogy_serve.h)
+static int serve_open(void* ctx) {
+    struct path_session* s = ctx;
+    session_init(s);
+    s->unlocked = 1;
+    return 0;
+}
+
+static void serve_close(void* ctx) {
+    session_free(ctx);
 }
 
+static const struct trilogy_service path_service = {
+    sizeof(struct path_session), serve_open, serve_close, pipe_answer
+};
+
 // ============== MAIN ==============
 int main(int argc, char** argv) {
+    init_magic_key();
+    configure_engine();
+    
+    if (argc >= 6 && strcmp(argv[1], "--dynamic") == 0) {
+        return run_dynamic_file(argv[2], atoi(argv[3]), atoi(argv[4]), atoi(argv[5]));
+    }
+    
+    if (argc >= 3 && strcmp(argv[1], "--apsp") == 0) {
+        return run_apsp_file(argv[2]);
+    }
+    
+    if (argc >= 4 && strcmp(argv[1], "--sssp") == 0) {
+        return run_sssp_file(argv[2], (int32_t)atoi(argv[3]),
+                             argc >= 5 ? (int32_t)atoi(argv[4]) : -1,
+                             argc >= 6 ? argv[5] : NULL);
+    }
+    
     if (argc < 2) {
         display_locked();
-        printf("Usage: %s <unlock_key> [path]\n", argv[0]);
+        printf("Usage: %s <unlock_key> [path | --route <src> <dst> <path>]\n", argv[0]);
         return 1;
     }
     
@@ -307,29 +2360,58 @@ int main(int argc, char** argv) {
     
     // Decrypt graph
     decrypt_weights(argv[1]);
-    is_unlocked = 1;
+    if (build_path_cache() < 0) {
+        printf("Out of memory.\n");
+        return 1;
+    }
+    load_congestion_rounds();
+    
+    // Server mode: <unlock_key> --serve <port> [workers], a session per connection
+    if (argc >= 4 && strcmp(argv[2], "--serve") == 0) {
+        return trilogy_serve(atoi(argv[3]), argc >= 5 ? atoi(argv[4]) : 0, &path_service) < 0;
+    }
+    
+    // Graph and tree are shared from here on; the player gets a session
+    struct path_session session;
+    session_init(&session);
+    session.unlocked = 1;
+    int rc = 0;
+    
+    // Pipelined checker mode: <unlock_key> --pipe, one record per path
+    if (argc >= 3 && strcmp(argv[2], "--pipe") == 0) {
+        rc = trilogy_batch_run(STDIN_FILENO, STDOUT_FILENO, &session, pipe_answer) < 0;
+        session_free(&session);
+        return rc;
+    }
+    
+    // Arbitrary endpoints: <unlock_key> --route <src> <dst> <path>
+    if (argc >= 6 && strcmp(argv[2], "--route") == 0) {
+        rc = check_route(session.graph, atoi(argv[3]), atoi(argv[4]), argv[5]);
+        session_free(&session);
+        return rc;
+    }
     
     // If path provided, verify it
     if (argc >= 3) {
-        int cost;
-        int result = verify_path(argv[2], &cost);
-        int optimal = find_optimal();
+        int64_t cost;
+        int result = verify_path(session.graph, argv[2], &cost);
+        int64_t optimal = find_optimal(&session);
         
+        display_unlocked();
         if (result == 1 && cost == optimal) {
-            strncpy(correct_answer, argv[2], 63);
-            display_unlocked();
-            printf("Path verified: cost %d (OPTIMAL)\n", cost);
-            print_flag();
-            return 0;
+            strncpy(session.correct_answer, argv[2], 63);
+            printf("Path verified: cost %lld (OPTIMAL)\n", (long long)cost);
+            print_flag(session.correct_answer);
         } else if (result == 1) {
-            display_unlocked();
-            printf("Valid path, cost %d, but not optimal (%d).\n", cost, optimal);
-            return 1;
+            printf("Valid path, cost %lld, but not optimal (%lld).\n",
+                   (long long)cost, (long long)optimal);
+            rc = 1;
         } else {
-            display_unlocked();
             printf("Invalid path (error %d).\n", result);
-            return 1;
+            rc = 1;
         }
+        session_free(&session);
+        return rc;
     }
     
     display_unlocked();
@@ -345,24 +2427,26 @@ int main(int argc, char** argv) {
         if (strcmp(input, "quit") == 0) break;
         
         if (strlen(input) > 0) {
-            int cost;
-            int result = verify_path(input, &cost);
-            int optimal = find_optimal();
+            int64_t cost;
+            int result = verify_path(session.graph, input, &cost);
+            int64_t optimal = find_optimal(&session);
             
             if (result == 1 && cost == optimal) {
-                strncpy(correct_answer, input, 63);
-                print_flag();
-                return 0;
+                strncpy(session.correct_answer, input, 63);
+                print_flag(session.correct_answer);
+                break;
             } else if (result == 1) {
-                printf("Valid path (cost %d) but not optimal.\n", cost);
+                printf("Valid path (cost %lld) but not optimal.\n", (long long)cost);
             } else {
                 printf("Invalid path.\n");
             }
+            if (session_next_round(&session)) printf("Traffic conditions changed.\n");
         }
         
         printf("Enter path: ");
         fflush(stdout);
     }
     
+    session_free(&session);
     return 0;
 }
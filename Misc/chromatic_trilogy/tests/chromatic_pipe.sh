@@ -0,0 +1,123 @@
+#!/bin/bash
+# CHROMATIC CORE --pipe regressions: a session re-verifies each coloring
+# incrementally from the previous one, so long answer sequences are
+# replayed against a full recount of every coloring; hash answers must
+# match the reference coloring up to color permutation and nothing else.
+#
+#   tests/chromatic_pipe.sh           (needs gcc and python3)
+#   CFLAGS=-fsanitize=address tests/chromatic_pipe.sh
+
+set -e
+DIR=$(cd "$(dirname "$0")/.." && pwd)
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+gcc -O2 -pthread -o "$TMP/chromatic" "$DIR/chromatic_core/src/chromatic.c" ${CFLAGS:-}
+gcc -O2 -o "$TMP/trilogy_pack" "$DIR/common/trilogy_pack.c"
+
+failed=0
+
+# First word of every --pipe record. A flag decoded from a wrong answer is
+# arbitrary bytes, so "ok" records are split by the flag's length
+records() {
+    python3 -c 'import sys
+out, flag_len = sys.stdin.buffer.read(), len("L3m0nCTF{chr0m4t1c_c0mpl3t3_d34db33f}")
+while out:
+    word = out.split(b" ", 1)[0] if out.startswith(b"ok ") else out.split(b"\n", 1)[0]
+    print(word.decode())
+    out = out[len(word) + 2 + flag_len:] if word == b"ok" else out[len(word) + 1:]'
+}
+
+# replay <name> <nodes> <colors> <seed>: a random graph with a planted
+# coloring, keyed for SEED_B (0x0a), and answers that walk between random
+# colorings and the planted one a few nodes at a time, with some large
+# jumps and malformed lines in between. Writes the graph, the answers and
+# the expected first word of every record.
+replay() {
+    python3 - "$TMP/$1" "$2" "$3" "$4" <<'EOF'
+import random, struct, sys
+out, n, k, seed = sys.argv[1], int(sys.argv[2]), int(sys.argv[3]), int(sys.argv[4])
+rng = random.Random(seed)
+planted = [rng.randrange(k) for _ in range(n)]
+edges = set()
+while len(edges) < 4 * n:
+    u, v = rng.randrange(n), rng.randrange(n)
+    if planted[u] != planted[v]:
+        edges.add((min(u, v), max(u, v)))
+with open(out + ".edges", "wb") as f:
+    f.write(b"".join(struct.pack("<2I", u, v) for u, v in sorted(edges)))
+
+answers, expect = [], []
+def submit(c):
+    answers.append(",".join(map(str, c)))
+    expect.append("no" if any(c[u] == c[v] for u, v in edges) else "ok")
+
+cur = [rng.randrange(k) for _ in range(n)]
+for walk in range(12):
+    target = planted if walk % 2 == 0 else [rng.randrange(k) for _ in range(n)]
+    if walk % 4 == 0:
+        perm = rng.sample(range(k), k)
+        target = [perm[c] for c in target]
+    diff = [v for v in range(n) if cur[v] != target[v]]
+    rng.shuffle(diff)
+    while diff:
+        for v in diff[:rng.choice((1, 1, 2, 3))]:
+            cur[v] = target[v]
+        diff = [v for v in diff if cur[v] != target[v]]
+        submit(cur)
+        if rng.random() < 0.05:
+            answers.append(",".join(map(str, cur[:-1])))
+            expect.append("no")
+            answers.append(",".join(map(str, cur[:-1] + [k])))
+            expect.append("no")
+    cur = [rng.randrange(k) for _ in range(n)]
+    submit(cur)
+with open(out + ".in", "w") as f:
+    f.write("\n".join(answers) + "\n")
+with open(out + ".want", "w") as f:
+    f.write("\n".join(expect) + "\n")
+EOF
+    "$TMP/trilogy_pack" -k 0x0a -c "$3" "$TMP/$1.edges" "$TMP/$1.graph" > /dev/null
+    TRILOGY_GRAPH="$TMP/$1.graph" "$TMP/chromatic" SEED_B --pipe < "$TMP/$1.in" | records > "$TMP/$1.got"
+    if ! cmp -s "$TMP/$1.got" "$TMP/$1.want"; then
+        echo "FAIL $1: first mismatch at answer $(cmp "$TMP/$1.got" "$TMP/$1.want" | sed -n 's/.*line //p')"
+        failed=1
+    else
+        echo "ok   $1 ($(grep -c ok "$TMP/$1.want") valid of $(wc -l < "$TMP/$1.want"))"
+    fi
+}
+
+replay four-colors 150 4 1
+replay six-colors 150 6 2
+replay sixteen-colors 40 16 3
+
+# Hash answers on the built-in graph: the reference coloring under every
+# color permutation, hashed after relabeling, must be accepted; other valid
+# colorings (587dd36b is the one DSATUR finds) and unrelated values not
+python3 - "$TMP/hash" <<'EOF'
+import itertools, sys
+ref = [0, 1, 2, 1, 0, 2, 1, 0, 2, 1, 0, 2, 1, 0, 2, 0]
+def canon_hash(c):
+    label, h = {}, 0x811c9dc5
+    for x in c:
+        h = ((h ^ label.setdefault(x, len(label))) * 0x01000193) & 0xffffffff
+    return "%08x" % h
+answers, expect = [], []
+for perm in itertools.permutations(range(3)):
+    c = [perm[x] for x in ref]
+    answers += [",".join(map(str, c)), canon_hash(c)]
+    expect += ["ok", "ok"]
+answers += ["587dd36b", canon_hash(ref[1:] + ref[:1]), "%08x" % (int(canon_hash(ref), 16) ^ 1), "0"]
+expect += ["no"] * 4
+open(sys.argv[1] + ".in", "w").write("\n".join(answers) + "\n")
+open(sys.argv[1] + ".want", "w").write("\n".join(expect) + "\n")
+EOF
+"$TMP/chromatic" SEED_B --pipe < "$TMP/hash.in" | records > "$TMP/hash.got"
+if ! cmp -s "$TMP/hash.got" "$TMP/hash.want"; then
+    echo "FAIL hashes: $(paste -d' ' "$TMP/hash.in" "$TMP/hash.got" | tr '\n' ';')"
+    failed=1
+else
+    echo "ok   hashes"
+fi
+
+exit $failed
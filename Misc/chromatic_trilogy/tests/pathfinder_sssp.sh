@@ -0,0 +1,57 @@
+#!/bin/bash
+# PATHFINDER --sssp regressions: both engines must agree on distances,
+# produce a usable predecessor tree and an ALT distance equal to the SSSP
+# one on the small graphs below.
+#
+#   tests/pathfinder_sssp.sh          (needs gcc and python3)
+#   CFLAGS=-fsanitize=address tests/pathfinder_sssp.sh
+
+set -e
+DIR=$(cd "$(dirname "$0")/.." && pwd)
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+gcc -O2 -pthread -o "$TMP/pathfinder" "$DIR/pathfinder/src/pathfinder.c" ${CFLAGS:-}
+
+# Raw arc file: little-endian uint32 triples "u v w", one per argument
+arcs() {
+    local out=$1
+    shift
+    python3 -c 'import struct, sys
+sys.stdout.buffer.write(b"".join(struct.pack("<3I", *map(int, a.split())) for a in sys.argv[1:]))' "$@" > "$out"
+}
+
+failed=0
+
+# expect <name> <graph> <src> <dst> <expected Path line>
+expect() {
+    for engine in dijkstra delta; do
+        out=$(PATHFINDER_ENGINE=$engine PATHFINDER_THREADS=3 "$TMP/pathfinder" --sssp "$2" "$3" "$4" 2>&1)
+        got=$(echo "$out" | grep '^Path')
+        alt=$(echo "$out" | sed -n 's/.*) = \([0-9]*\) (SSSP \([0-9]*\)).*/\1 \2/p')
+        if [ "$got" != "$5" ]; then
+            echo "FAIL $1 ($engine): got '$got', want '$5'"
+            failed=1
+        elif [ -z "$alt" ] || [ "${alt% *}" != "${alt#* }" ]; then
+            echo "FAIL $1 ($engine): ALT disagrees with SSSP: $(echo "$out" | grep -E '^ALT|ERROR')"
+            failed=1
+        else
+            echo "ok   $1 ($engine)"
+        fi
+    done
+}
+
+# Node 5 is reached only over zero-weight arcs; 2 -> 1 closes a zero cycle
+arcs "$TMP/zero.bin" "0 1 0" "1 2 0" "2 3 0" "3 4 0" "0 4 5" "4 5 2" "2 1 0"
+expect zero-weight-chain "$TMP/zero.bin" 0 5 "Path: 0 1 2 3 4 5 (cost 2)"
+
+# Directed chain 0 -> ... -> 20 where every chain node also points at the
+# dead end 21: the landmark bound rules 21 out, yet every settled node
+# scans an arc into it again
+dead=()
+for i in $(seq 0 19); do dead+=("$i $((i + 1)) 1" "$i 21 1"); done
+arcs "$TMP/dead.bin" "${dead[@]}"
+expect dead-end "$TMP/dead.bin" 0 20 "Path: $(seq -s ' ' 0 20) (cost 20)"
+expect unreachable "$TMP/dead.bin" 20 0 "Path: none"
+
+exit $failed
@@ -9,6 +9,9 @@
  * 
  * Flag: L3m0nCTF{v3rt3x_GRAPHKEY_7f2a9b}
  *       The GRAPHKEY portion is used to unlock PATHFINDER
+ *
+ * TRILOGY_GRAPH=<graph_file> replaces the built-in matrix with a trilogy
+ * graph file keyed with the magic-marker key (up to VERTEX_MAX_VERTICES).
  */
 
 #include <stdio.h>
@@ -17,53 +20,134 @@
 #include <stdint.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../../common/trilogy_crypt.h"
+#include "../../common/trilogy_graph.h"
+#include "../../common/trilogy_parse.h"
+#include "../../common/trilogy_batch.h"
+#include "../../common/trilogy_serve.h"
 
 // ============== MAGIC MARKER FOR KEY DERIVATION ==============
-__attribute__((section(".magic")))
-__attribute__((aligned(4096)))
-static const char magic_marker[32] = "VERTEX_V2_CHROMATIC_HARDENED";
+#define MAGIC_TEXT "VERTEX_V2_CHROMATIC_HARDENED"
+_Static_assert(TRILOGY_MAGIC_FITS(MAGIC_TEXT), "magic marker too long");
+TRILOGY_MAGIC static const char magic_marker[TRILOGY_MAGIC_LEN] = MAGIC_TEXT;
+
+// Bounds of the marker section, provided by the linker
+extern const char __start_trilogy_magic[], __stop_trilogy_magic[];
 
 // ============== CONFIGURATION ==============
 #define NUM_VERTICES 12
 #define GRAPH_XOR_KEY 0x5A  // Key to decrypt adjacency matrix
 
-// ============== ENCRYPTED ADJACENCY MATRIX ==============
+// ============== ENCRYPTED ADJACENCY ROWS ==============
 // The actual graph is bipartite with SCRAMBLED sets:
 // Set A = {0, 2, 5, 7, 8, 11}  (NOT simple 0-5!)
 // Set B = {1, 3, 4, 6, 9, 10}
-// XOR key = 0x76 (derived from magic_marker first 16 bytes)
+// Authored as plaintext neighbour masks and encrypted by the compiler:
+// each 64-bit row is XORed with key 0x76 (derived from magic_marker first
+// 16 bytes) repeated over the word, so decoding is one XOR per row.
+#define VERTEX_GRAPH_KEY 0x76
+#define N(v) (1ULL << (v))
+#define ROW(bits) ((bits) ^ TRILOGY_KEY64(VERTEX_GRAPH_KEY))
+
+_Static_assert(NUM_VERTICES <= 64, "built-in rows are one word each");
+
 __attribute__((section(".graph_data")))
-static const uint8_t encrypted_adj[NUM_VERTICES][NUM_VERTICES] = {
-    // Row 0: connects to [1, 9, 10]
-    {0x76, 0x77, 0x76, 0x76, 0x76, 0x76, 0x76, 0x76, 0x76, 0x77, 0x77, 0x76},
-    // Row 1: connects to [0, 5, 7, 8, 11]
-    {0x77, 0x76, 0x76, 0x76, 0x76, 0x77, 0x76, 0x77, 0x77, 0x76, 0x76, 0x77},
-    // Row 2: connects to [3, 4, 10]
-    {0x76, 0x76, 0x76, 0x77, 0x77, 0x76, 0x76, 0x76, 0x76, 0x76, 0x77, 0x76},
-    // Row 3: connects to [2, 5, 11]
-    {0x76, 0x76, 0x77, 0x76, 0x76, 0x77, 0x76, 0x76, 0x76, 0x76, 0x76, 0x77},
-    // Row 4: connects to [2]
-    {0x76, 0x76, 0x77, 0x76, 0x76, 0x76, 0x76, 0x76, 0x76, 0x76, 0x76, 0x76},
-    // Row 5: connects to [1, 3, 10]
-    {0x76, 0x77, 0x76, 0x77, 0x76, 0x76, 0x76, 0x76, 0x76, 0x76, 0x77, 0x76},
-    // Row 6: connects to [8]
-    {0x76, 0x76, 0x76, 0x76, 0x76, 0x76, 0x76, 0x76, 0x77, 0x76, 0x76, 0x76},
-    // Row 7: connects to [1, 9, 10]
-    {0x76, 0x77, 0x76, 0x76, 0x76, 0x76, 0x76, 0x76, 0x76, 0x77, 0x77, 0x76},
-    // Row 8: connects to [1, 6, 9]
-    {0x76, 0x77, 0x76, 0x76, 0x76, 0x76, 0x77, 0x76, 0x76, 0x77, 0x76, 0x76},
-    // Row 9: connects to [0, 7, 8]
-    {0x77, 0x76, 0x76, 0x76, 0x76, 0x76, 0x76, 0x77, 0x77, 0x76, 0x76, 0x76},
-    // Row 10: connects to [0, 2, 5, 7, 11]
-    {0x77, 0x76, 0x77, 0x76, 0x76, 0x77, 0x76, 0x77, 0x76, 0x76, 0x76, 0x77},
-    // Row 11: connects to [1, 3, 10]
-    {0x76, 0x77, 0x76, 0x77, 0x76, 0x76, 0x76, 0x76, 0x76, 0x76, 0x77, 0x76}
+static const uint64_t encrypted_adj[NUM_VERTICES] = {
+    ROW(N(1) | N(9) | N(10)),                   // 0
+    ROW(N(0) | N(5) | N(7) | N(8) | N(11)),     // 1
+    ROW(N(3) | N(4) | N(10)),                   // 2
+    ROW(N(2) | N(5) | N(11)),                   // 3
+    ROW(N(2)),                                  // 4
+    ROW(N(1) | N(3) | N(10)),                   // 5
+    ROW(N(8)),                                  // 6
+    ROW(N(1) | N(9) | N(10)),                   // 7
+    ROW(N(1) | N(6) | N(9)),                    // 8
+    ROW(N(0) | N(7) | N(8)),                    // 9
+    ROW(N(0) | N(2) | N(5) | N(7) | N(11)),     // 10
+    ROW(N(1) | N(3) | N(10))                    // 11
 };
 
+#undef N
+#undef ROW
+
 // ============== DECRYPTED GRAPH (computed at runtime) ==============
-static uint8_t adj_matrix[NUM_VERTICES][NUM_VERTICES];
+// Bit-packed adjacency: bit j of row i (adj_rows + i * adj_words) is set
+// iff i-j is an edge. One bit per pair instead of one byte, so large
+// instances stay 8x smaller; graph files are capped at VERTEX_MAX_VERTICES
+// (32 MB of rows), larger graphs go through --edges.
+#define ROW_WORDS(n) (((n) + 63) / 64)
+#define VERTEX_MAX_VERTICES 16384
+
+static uint64_t* adj_rows;
+static int num_vertices = NUM_VERTICES;
+static int adj_words = ROW_WORDS(NUM_VERTICES);
 static int graph_decrypted = 0;
 
+// ============== BITSET HELPERS ==============
+static inline int bitset_test(const uint64_t* set, size_t i) {
+    return (set[i >> 6] >> (i & 63)) & 1;
+}
+
+static inline void bitset_set(uint64_t* set, size_t i) {
+    set[i >> 6] |= 1ULL << (i & 63);
+}
+
+// ============== CANONICAL 2-COLORING (computed once in init_graph) ==============
+// BFS from the smallest vertex of every component; side_label holds the
+// BFS parity, component[] the component index. A submission only has to
+// match these labels (or their complement) per component.
+static uint64_t* side_label;
+static int* component;
+static int num_components = 0;
+static int graph_bipartite = 0;
+
+// O(V + V^2/64): neighbours are taken as row & unvisited, so every vertex
+// is enqueued once and every row is scanned once. Returns the number of
+// components, or -1 if an edge joins two vertices of the same parity.
+static int two_color(const uint64_t* rows, int words, int n,
+                     uint64_t* label, int* comp, int* queue, uint64_t* scratch) {
+    uint64_t* unvisited = scratch;
+    uint64_t* seen_side[2] = { scratch + words, scratch + 2 * words };
+    
+    memset(scratch, 0, 3 * (size_t)words * sizeof(uint64_t));
+    memset(label, 0, (size_t)words * sizeof(uint64_t));
+    for (int v = 0; v < n; v++) bitset_set(unvisited, v);
+    
+    int comps = 0;
+    for (int root = 0; root < n; root++) {
+        if (!bitset_test(unvisited, root)) continue;
+        
+        int head = 0, tail = 0;
+        queue[tail++] = root;
+        unvisited[root >> 6] &= ~(1ULL << (root & 63));
+        
+        while (head < tail) {
+            int u = queue[head++];
+            int s = bitset_test(label, u);
+            const uint64_t* row = rows + (size_t)u * words;
+            comp[u] = comps;
+            bitset_set(seen_side[s], u);
+            
+            for (int w = 0; w < words; w++) {
+                if (row[w] & seen_side[s][w]) return -1;  // odd cycle
+                uint64_t fresh = row[w] & unvisited[w];
+                unvisited[w] &= ~fresh;
+                if (!s) label[w] |= fresh;
+                while (fresh) {
+                    queue[tail++] = (w << 6) | __builtin_ctzll(fresh);
+                    fresh &= fresh - 1;
+                }
+            }
+        }
+        comps++;
+    }
+    return comps;
+}
+
 // ============== RED HERRING: Fake decryption key ==============
 __attribute__((section(".rodata")))
 static const uint8_t fake_key[] = {0xDE, 0xAD, 0xBE, 0xEF, 0xCA, 0xFE};
@@ -86,33 +170,96 @@ static void init_graph(void) {
         key ^= (uint8_t)magic_marker[i];
     }
     
-    for (int i = 0; i < NUM_VERTICES; i++) {
-        for (int j = 0; j < NUM_VERTICES; j++) {
-            adj_matrix[i][j] = encrypted_adj[i][j] ^ key;
+    const char* path = getenv(TRILOGY_GRAPH_ENV);
+    struct trilogy_graph f = {0};
+    if (path) {
+        int rc = trilogy_graph_open(path, key, &f);
+        if (rc < 0 || f.n > VERTEX_MAX_VERTICES) {
+            fprintf(stderr, "Cannot load graph %s: %s.\n", path,
+                    rc < 0 ? trilogy_graph_strerror(rc) : "too many vertices");
+            exit(1);
+        }
+        num_vertices = f.n;
+        adj_words = ROW_WORDS(num_vertices);
+    }
+    
+    size_t words = (size_t)adj_words;
+    adj_rows = calloc((size_t)num_vertices * words, sizeof(uint64_t));
+    side_label = calloc(words, sizeof(uint64_t));
+    component = malloc((size_t)num_vertices * sizeof(int));
+    int* queue = malloc((size_t)num_vertices * sizeof(int));
+    uint64_t* scratch = malloc(3 * words * sizeof(uint64_t));
+    if (!adj_rows || !side_label || !component || !queue || !scratch) {
+        fprintf(stderr, "Out of memory.\n");
+        exit(1);
+    }
+    
+    if (path) {
+        for (int32_t u = 0; u < f.n; u++) {
+            for (int64_t k = f.row_ptr[u]; k < f.row_ptr[u + 1]; k++) {
+                bitset_set(adj_rows + (size_t)u * words, (size_t)f.col[k]);
+                bitset_set(adj_rows + (size_t)f.col[k] * words, (size_t)u);
+            }
         }
+        trilogy_graph_close(&f);
+    } else {
+        // One word per row: decode the whole table in one pass
+        trilogy_xor_into(adj_rows, encrypted_adj, sizeof(encrypted_adj), key);
     }
     
+    // Graph is fixed from here on: label it once for every later attempt
+    num_components = two_color(adj_rows, adj_words, num_vertices,
+                               side_label, component, queue, scratch);
+    graph_bipartite = num_components > 0;
+    free(queue);
+    free(scratch);
+    
     graph_decrypted = 1;
 }
 
+// ============== SESSIONS ==============
+// Graph and canonical labels are written once by init_graph and only read
+// afterwards, so any number of sessions share them across threads. A
+// session owns its submission scratch and the answer that keys its flag.
+struct vertex_session {
+    uint64_t* masks;        // set A then set B, adj_words each
+    int8_t* flip;           // per component, for verify_answer
+    char correct_answer[64];
+};
+
+// Requires init_graph
+static int session_init(struct vertex_session* s) {
+    memset(s, 0, sizeof(*s));
+    s->masks = malloc(2 * (size_t)adj_words * sizeof(uint64_t));
+    s->flip = malloc((size_t)num_vertices);
+    if (!s->masks || !s->flip) {
+        free(s->masks);
+        free(s->flip);
+        return -1;
+    }
+    return 0;
+}
+
+static void session_free(struct vertex_session* s) {
+    free(s->masks);
+    free(s->flip);
+    memset(s, 0, sizeof(*s));
+}
+
 // ============== REAL: Key derivation for flag ==============
 // Key depends on BOTH magic bytes AND correct answer
+// Fold of the magic section, taken once at startup
+static uint8_t magic_key;
+
+static void init_magic_key(void) {
+    magic_key = trilogy_fold(__start_trilogy_magic,
+                             (size_t)(__stop_trilogy_magic - __start_trilogy_magic));
+}
+
 static uint8_t derive_flag_key(const char* answer) {
-    uint8_t buffer[32];
-    int fd = open("/proc/self/exe", O_RDONLY);
-    if (fd < 0) return 0x42;
-    
-    lseek(fd, 0x3000, SEEK_SET);
-    ssize_t n = read(fd, buffer, 32);
-    close(fd);
-    
-    if (n < 32) return 0x42;
-    
-    uint8_t key = 0;
-    for (int i = 0; i < 32; i++) {
-        key ^= buffer[i];
-    }
+    uint8_t key = magic_key;
     
+    // XOR with answer bytes - makes key answer-dependent!
     for (size_t i = 0; answer[i]; i++) {
         key ^= (uint8_t)answer[i];
     }
@@ -124,79 +271,593 @@ static uint8_t derive_flag_key(const char* answer) {
 // Player must provide actual bipartite partition
 // Format: "set_a_vertices:set_b_vertices" (comma-separated, sorted)
 // Correct: "0,2,5,7,8,11:1,3,4,6,9,10"
-static int verify_answer(const char* input) {
-    // Parse input format: "a,b,c:d,e,f"
-    int set_a[12] = {0}, set_b[12] = {0};
-    int in_set_a[12] = {0}, in_set_b[12] = {0};
+
+// Adds the list in [s, end) to mask; a vertex out of range or already in
+// either set fails. Returns the number listed or -1.
+static int parse_side(const char* s, const char* end, uint64_t* mask, const uint64_t* other) {
+    struct trilogy_list list;
+    int32_t v;
+    int count = 0, rc;
     
-    char* colon = strchr(input, ':');
+    trilogy_list_init(&list, s, end, ',', (uint32_t)num_vertices);
+    while ((rc = trilogy_list_next(&list, &v)) > 0) {
+        if (bitset_test(mask, v) || bitset_test(other, v)) return -1;
+        bitset_set(mask, v);
+        count++;
+    }
+    return rc < 0 ? -1 : count;
+}
+
+// Parses "a,b,c:d,e,f" into set A and set B masks of adj_words words;
+// returns 1 only for a complete partition that lists every vertex exactly
+// once. Duplicates and bounds are checked while parsing.
+static int parse_answer(const char* input, uint64_t* set_a_mask, uint64_t* set_b_mask) {
+    memset(set_a_mask, 0, (size_t)adj_words * sizeof(uint64_t));
+    memset(set_b_mask, 0, (size_t)adj_words * sizeof(uint64_t));
+    
+    const char* colon = strchr(input, ':');
     if (!colon) return 0;
+    int count_a = parse_side(input, colon, set_a_mask, set_b_mask);
+    int count_b = count_a < 0 ? -1 : parse_side(colon + 1, colon + 1 + strlen(colon + 1),
+                                                set_b_mask, set_a_mask);
+    
+    // Disjoint and in range, so the counts add up only if every vertex is used
+    return count_b >= 0 && count_a + count_b == num_vertices;
+}
+
+static int verify_answer(struct vertex_session* sess, const char* input) {
+    uint64_t* set_b_mask = sess->masks + adj_words;
+    int8_t* flip = sess->flip;
+    int ok = parse_answer(input, sess->masks, set_b_mask) && graph_bipartite;
     
-    // Parse set A
-    char* copy = strdup(input);
-    copy[colon - input] = '\0';
-    char* tok = strtok(copy, ",");
-    int count_a = 0;
-    while (tok && count_a < 12) {
-        int v = atoi(tok);
-        if (v < 0 || v >= 12) { free(copy); return 0; }
-        set_a[count_a++] = v;
-        in_set_a[v] = 1;
-        tok = strtok(NULL, ",");
-    }
-    
-    // Parse set B
-    char* part_b = strdup(colon + 1);
-    tok = strtok(part_b, ",");
-    int count_b = 0;
-    while (tok && count_b < 12) {
-        int v = atoi(tok);
-        if (v < 0 || v >= 12) { free(copy); free(part_b); return 0; }
-        set_b[count_b++] = v;
-        in_set_b[v] = 1;
-        tok = strtok(NULL, ",");
-    }
-    free(copy);
-    free(part_b);
-    
-    // Check partition is complete (all 12 vertices used exactly once)
-    if (count_a + count_b != 12) return 0;
-    for (int i = 0; i < 12; i++) {
-        if (in_set_a[i] + in_set_b[i] != 1) return 0;
-    }
-    
-    // Check bipartite property: no edges within same set
-    for (int i = 0; i < 12; i++) {
-        for (int j = i + 1; j < 12; j++) {
-            if (adj_matrix[i][j]) {
-                // There's an edge i-j, must be in different sets
-                if ((in_set_a[i] && in_set_a[j]) || (in_set_b[i] && in_set_b[j])) {
-                    return 0;  // Invalid partition!
+    // Check bipartite property against the canonical labels: inside each
+    // component, set B must equal the labels or their complement. O(V).
+    if (ok) memset(flip, -1, (size_t)num_vertices);
+    for (int v = 0; ok && v < num_vertices; v++) {
+        int8_t s = (int8_t)(bitset_test(set_b_mask, v) ^ bitset_test(side_label, v));
+        int c = component[v];
+        if (flip[c] < 0) {
+            flip[c] = s;
+        } else if (flip[c] != s) {
+            ok = 0;
+        }
+    }
+    
+    return ok;  // 1: valid bipartite partition!
+}
+
+// ============== BIT-SLICED BATCH VERIFICATION ==============
+// Checks 64 candidate partitions at once. slices[v] holds one bit per
+// candidate: bit k is set iff candidate k puts v in set B. An edge u-v is
+// violated by candidate k iff bit k of slices[u] and slices[v] agree, so
+// each edge costs one XOR/NOT/OR for all 64 candidates together.
+// Returns the mask of candidates that violate no edge.
+static uint64_t verify_batch(const uint64_t* rows, int words, int n, const uint64_t* slices) {
+    uint64_t bad = 0;
+    
+    for (int u = 0; u < n && bad != UINT64_MAX; u++) {
+        const uint64_t* row = rows + (size_t)u * words;
+        uint64_t su = slices[u];
+        
+        // Each undirected edge once: only neighbours v > u
+        int w = (u + 1) >> 6;
+        uint64_t bits = w < words ? row[w] & (~0ULL << ((u + 1) & 63)) : 0;
+        for (;;) {
+            while (bits) {
+                int v = (w << 6) | __builtin_ctzll(bits);
+                bits &= bits - 1;
+                bad |= ~(su ^ slices[v]);
+            }
+            if (++w >= words) break;
+            bits = row[w];
+        }
+    }
+    
+    return ~bad;
+}
+
+// Batch mode: candidate partitions on stdin, one per line. Every group of
+// up to 64 lines is answered with one validity mask (bit k = line k).
+static int run_batch_mode(struct vertex_session* sess) {
+    char* line = NULL;
+    size_t cap = 0;
+    uint64_t* slices = malloc((size_t)num_vertices * sizeof(uint64_t));
+    uint64_t* set_b_mask = sess->masks + adj_words;
+    if (!slices) {
+        printf("Out of memory.\n");
+        return 1;
+    }
+    
+    for (;;) {
+        uint64_t well_formed = 0;
+        int count = 0;
+        memset(slices, 0, (size_t)num_vertices * sizeof(uint64_t));
+        
+        while (count < 64 && getline(&line, &cap, stdin) > 0) {
+            line[strcspn(line, "\n")] = 0;
+            if (!line[0]) continue;
+            if (parse_answer(line, sess->masks, set_b_mask)) {
+                for (int v = 0; v < num_vertices; v++) {
+                    slices[v] |= (uint64_t)bitset_test(set_b_mask, v) << count;
                 }
+                well_formed |= 1ULL << count;
+            }
+            count++;
+        }
+        if (count == 0) break;
+        
+        uint64_t valid = graph_bipartite
+            ? verify_batch(adj_rows, adj_words, num_vertices, slices) & well_formed
+            : 0;
+        printf("%d 0x%016llx\n", count, (unsigned long long)valid);
+        fflush(stdout);
+        if (count < 64) break;
+    }
+    
+    free(line);
+    free(slices);
+    return 0;
+}
+
+// ============== STREAMING EDGE-FILE MODE ==============
+// Verifies a partition against an external sparse graph in one sequential
+// pass. Edge file: little-endian uint32 pairs (u, v), 8 bytes per edge, or
+// a plain trilogy graph file (scanned row by row in place).
+// Partition file: same "a,b,c:d,e,f" text format as verify_answer.
+// Only two V/8-byte bitsets are held in memory, never a V^2 matrix.
+
+struct mapped_file {
+    const uint8_t* data;
+    size_t size;
+};
+
+static int map_file(const char* path, struct mapped_file* out) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size == 0) { close(fd); return -1; }
+    
+    void* p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return -1;
+    
+    madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+    out->data = p;
+    out->size = (size_t)st.st_size;
+    return 0;
+}
+
+static void unmap_file(struct mapped_file* f) {
+    if (f->data) munmap((void*)f->data, f->size);
+    f->data = NULL;
+}
+
+// Growable bitset pair for partition membership
+struct partition_bits {
+    uint64_t* seen;     // vertex listed in either set
+    uint64_t* side_b;   // vertex listed in set B
+    size_t words;
+    uint32_t num_vertices;  // highest listed id + 1
+};
+
+static int partition_mark(struct partition_bits* p, uint32_t v, int in_b) {
+    size_t need = (size_t)(v >> 6) + 1;
+    if (need > p->words) {
+        size_t words = p->words ? p->words : 1024;
+        while (words < need) words *= 2;
+        uint64_t* seen = realloc(p->seen, words * sizeof(uint64_t));
+        if (!seen) return 0;
+        p->seen = seen;
+        uint64_t* side_b = realloc(p->side_b, words * sizeof(uint64_t));
+        if (!side_b) return 0;
+        p->side_b = side_b;
+        memset(p->seen + p->words, 0, (words - p->words) * sizeof(uint64_t));
+        memset(p->side_b + p->words, 0, (words - p->words) * sizeof(uint64_t));
+        p->words = words;
+    }
+    
+    if (bitset_test(p->seen, v)) return 0;  // listed twice
+    bitset_set(p->seen, v);
+    if (in_b) bitset_set(p->side_b, v);
+    if (v + 1 > p->num_vertices) p->num_vertices = v + 1;
+    return 1;
+}
+
+static int parse_partition(const struct mapped_file* f, struct partition_bits* p) {
+    int in_b = 0, have_digit = 0;
+    uint64_t v = 0;
+    
+    for (size_t i = 0; i <= f->size; i++) {
+        uint8_t c = i < f->size ? f->data[i] : ',';
+        if (c >= '0' && c <= '9') {
+            v = v * 10 + (c - '0');
+            if (v > UINT32_MAX - 1) return 0;
+            have_digit = 1;
+            continue;
+        }
+        if (have_digit && !partition_mark(p, (uint32_t)v, in_b)) return 0;
+        have_digit = 0;
+        v = 0;
+        
+        if (c == ':') {
+            if (in_b) return 0;
+            in_b = 1;
+        } else if (c != ',' && c != '\n' && c != '\r' && c != ' ') {
+            return 0;
+        }
+    }
+    if (!in_b) return 0;
+    
+    // Partition must cover every vertex 0..V-1 exactly once
+    size_t covered = 0;
+    for (size_t w = 0; w < p->words; w++) {
+        covered += (size_t)__builtin_popcountll(p->seen[w]);
+    }
+    return covered == p->num_vertices;
+}
+
+static inline int edge_splits(const struct partition_bits* p, uint32_t u, uint32_t v) {
+    return u < p->num_vertices && v < p->num_vertices &&
+           bitset_test(p->side_b, u) != bitset_test(p->side_b, v);
+}
+
+static int verify_graph_file(const char* graph_path, const struct partition_bits* p) {
+    struct trilogy_graph g;
+    int rc = trilogy_graph_open(graph_path, 0, &g);
+    if (rc < 0) {
+        printf("Cannot load %s: %s.\n", graph_path, trilogy_graph_strerror(rc));
+        return 1;
+    }
+    
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    int32_t bad_u = -1, bad_v = -1;
+    int64_t scanned = 0;
+    for (int32_t u = 0; u < g.n && bad_u < 0; u++) {
+        for (int64_t k = g.row_ptr[u]; k < g.row_ptr[u + 1]; k++) {
+            scanned++;
+            if (!edge_splits(p, (uint32_t)u, (uint32_t)g.col[k])) {
+                bad_u = u;
+                bad_v = g.col[k];
+                break;
             }
         }
     }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double secs = (double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_nsec - t0.tv_nsec) / 1e9;
+    
+    // Every edge is stored as two arcs; rate in edges, as for raw edge files
+    double edges = (double)scanned / 2;
+    printf("Vertices: %u (graph %d)  Arcs scanned: %lld / %lld\n", p->num_vertices, g.n,
+           (long long)scanned, (long long)g.m);
+    printf("Throughput: %.1f Medges/s (%.3f ms)\n", secs > 0 ? edges / secs / 1e6 : 0.0, secs * 1e3);
+    if (bad_u >= 0) {
+        printf("Invalid: edge %d-%d stays inside one set.\n", bad_u, bad_v);
+    } else {
+        printf("Valid bipartition.\n");
+    }
+    trilogy_graph_close(&g);
+    return bad_u >= 0;
+}
+
+static int verify_edge_file(const char* edge_path, const char* partition_path) {
+    struct mapped_file edges = {0}, part = {0};
+    struct partition_bits p = {0};
+    int result = 1;
+    
+    if (trilogy_graph_sniff(edge_path)) {
+        if (map_file(partition_path, &part) < 0) {
+            printf("Cannot map input files.\n");
+        } else if (!parse_partition(&part, &p)) {
+            printf("Malformed or incomplete partition.\n");
+        } else {
+            result = verify_graph_file(edge_path, &p);
+        }
+        goto out;
+    }
+    
+    if (map_file(partition_path, &part) < 0 || map_file(edge_path, &edges) < 0) {
+        printf("Cannot map input files.\n");
+        unmap_file(&part);
+        return 1;
+    }
+    if (edges.size % 8 != 0) {
+        printf("Edge file is not a sequence of uint32 pairs.\n");
+        goto out;
+    }
+    if (!parse_partition(&part, &p)) {
+        printf("Malformed or incomplete partition.\n");
+        goto out;
+    }
+    
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    
+    const uint32_t* e = (const uint32_t*)edges.data;
+    size_t num_edges = edges.size / 8;
+    size_t bad = num_edges;
+    for (size_t i = 0; i < num_edges; i++) {
+        if (!edge_splits(&p, e[2 * i], e[2 * i + 1])) {
+            bad = i;
+            break;
+        }
+    }
+    
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double secs = (double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_nsec - t0.tv_nsec) / 1e9;
+    size_t scanned = bad < num_edges ? bad + 1 : num_edges;
+    
+    printf("Vertices: %u  Edges scanned: %zu / %zu\n", p.num_vertices, scanned, num_edges);
+    printf("Throughput: %.1f Medges/s (%.3f ms)\n",
+           secs > 0 ? (double)scanned / secs / 1e6 : 0.0, secs * 1e3);
+    if (bad < num_edges) {
+        printf("Invalid: edge %zu (%u-%u) stays inside one set.\n", bad, e[2 * bad], e[2 * bad + 1]);
+    } else {
+        printf("Valid bipartition.\n");
+        result = 0;
+    }
+    
+out:
+    free(p.seen);
+    free(p.side_b);
+    unmap_file(&edges);
+    unmap_file(&part);
+    return result;
+}
+
+// ============== STREAMING GRAPH MODE (parity union-find) ==============
+// Edges arrive one at a time on stdin. A union-find that tracks the parity
+// of every vertex relative to its root keeps bipartiteness and the current
+// partition up to date in near-O(1) per edge. Tree edges are kept as a
+// spanning forest so the first odd cycle can be reported as a certificate.
+//
+// Protocol (one command per line):
+//   <u> <v>          insert edge u-v
+//   check <a:b>      verify a partition against the edges seen so far
+//   partition        print the current partition
+struct parity_dsu {
+    uint32_t n;
+    uint32_t* parent;
+    uint8_t* parity;     // parity of the vertex relative to parent
+    uint8_t* rank;
+    // Spanning forest as adjacency lists, for odd-cycle certificates
+    int32_t* forest_head;
+    int32_t* forest_next;
+    uint32_t* forest_to;
+    uint32_t forest_edges;
+    int bipartite;
+};
+
+static int dsu_init(struct parity_dsu* d, uint32_t n) {
+    memset(d, 0, sizeof(*d));
+    d->n = n;
+    d->parent = malloc(n * sizeof(uint32_t));
+    d->parity = calloc(n, 1);
+    d->rank = calloc(n, 1);
+    d->forest_head = malloc(n * sizeof(int32_t));
+    d->forest_next = malloc(2 * (size_t)n * sizeof(int32_t));
+    d->forest_to = malloc(2 * (size_t)n * sizeof(uint32_t));
+    if (!d->parent || !d->parity || !d->rank || !d->forest_head ||
+        !d->forest_next || !d->forest_to) {
+        return 0;
+    }
+    for (uint32_t v = 0; v < n; v++) {
+        d->parent[v] = v;
+        d->forest_head[v] = -1;
+    }
+    d->bipartite = 1;
+    return 1;
+}
+
+static void dsu_free(struct parity_dsu* d) {
+    free(d->parent);
+    free(d->parity);
+    free(d->rank);
+    free(d->forest_head);
+    free(d->forest_next);
+    free(d->forest_to);
+}
+
+// Returns the root of v and stores v's parity relative to it. Two passes:
+// find the root and total parity, then point every vertex on the path
+// straight at the root with its own parity (full path compression).
+static uint32_t dsu_find(struct parity_dsu* d, uint32_t v, uint8_t* parity) {
+    uint32_t root = v;
+    uint8_t total = 0;
+    while (d->parent[root] != root) {
+        total ^= d->parity[root];
+        root = d->parent[root];
+    }
+    
+    uint32_t cur = v;
+    uint8_t cur_parity = total;
+    while (d->parent[cur] != root && cur != root) {
+        uint32_t next = d->parent[cur];
+        uint8_t next_parity = cur_parity ^ d->parity[cur];
+        d->parent[cur] = root;
+        d->parity[cur] = cur_parity;
+        cur = next;
+        cur_parity = next_parity;
+    }
     
-    return 1;  // Valid bipartite partition!
+    *parity = total;
+    return root;
 }
 
-// Stored correct answer for key derivation
-static char correct_answer[64] = {0};
+static void forest_link(struct parity_dsu* d, uint32_t u, uint32_t v) {
+    uint32_t e = d->forest_edges;
+    d->forest_to[e] = v;
+    d->forest_next[e] = d->forest_head[u];
+    d->forest_head[u] = (int32_t)e;
+    d->forest_to[e + 1] = u;
+    d->forest_next[e + 1] = d->forest_head[v];
+    d->forest_head[v] = (int32_t)(e + 1);
+    d->forest_edges = e + 2;
+}
+
+// Tree path u..v has even length (same parity), so path + (v,u) is odd.
+// Only runs once per instance, on the first conflicting edge.
+static void print_odd_cycle(const struct parity_dsu* d, uint32_t u, uint32_t v) {
+    uint32_t* prev = malloc(d->n * sizeof(uint32_t));
+    uint32_t* queue = malloc(d->n * sizeof(uint32_t));
+    if (!prev || !queue) {
+        free(prev);
+        free(queue);
+        printf("Odd cycle through edge %u-%u.\n", u, v);
+        return;
+    }
+    memset(prev, 0xFF, d->n * sizeof(uint32_t));
+    
+    uint32_t head = 0, tail = 0;
+    queue[tail++] = u;
+    prev[u] = u;
+    while (head < tail && prev[v] == UINT32_MAX) {
+        uint32_t x = queue[head++];
+        for (int32_t e = d->forest_head[x]; e >= 0; e = d->forest_next[e]) {
+            uint32_t y = d->forest_to[e];
+            if (prev[y] == UINT32_MAX) {
+                prev[y] = x;
+                queue[tail++] = y;
+            }
+        }
+    }
+    
+    uint32_t len = 1;
+    printf("Odd cycle: %u", v);
+    for (uint32_t x = v; x != u; x = prev[x]) {
+        printf("-%u", prev[x]);
+        len++;
+    }
+    printf("-%u (length %u)\n", v, len);
+    
+    free(prev);
+    free(queue);
+}
+
+static void dsu_add_edge(struct parity_dsu* d, uint32_t u, uint32_t v) {
+    uint8_t pu, pv;
+    uint32_t ru = dsu_find(d, u, &pu);
+    uint32_t rv = dsu_find(d, v, &pv);
+    
+    if (ru == rv) {
+        if (pu == pv && d->bipartite) {
+            d->bipartite = 0;
+            print_odd_cycle(d, u, v);
+        }
+        return;
+    }
+    
+    // Union by rank; the edge forces u and v onto opposite sides
+    if (d->rank[ru] < d->rank[rv]) {
+        uint32_t t = ru; ru = rv; rv = t;
+    }
+    d->parent[rv] = ru;
+    d->parity[rv] = pu ^ pv ^ 1;
+    if (d->rank[ru] == d->rank[rv]) d->rank[ru]++;
+    forest_link(d, u, v);
+}
+
+static int dsu_check_partition(struct parity_dsu* d, const char* text) {
+    struct mapped_file f = { (const uint8_t*)text, strlen(text) };
+    struct partition_bits p = {0};
+    int ok = d->bipartite && parse_partition(&f, &p) && p.num_vertices == d->n;
+    
+    // Within each component, side B must equal parity or its complement
+    uint8_t* flip = ok ? malloc(d->n) : NULL;
+    if (flip) {
+        memset(flip, 0xFF, d->n);
+        for (uint32_t v = 0; v < d->n && ok; v++) {
+            uint8_t pv;
+            uint32_t r = dsu_find(d, v, &pv);
+            uint8_t s = (uint8_t)bitset_test(p.side_b, v) ^ pv;
+            if (flip[r] == 0xFF) {
+                flip[r] = s;
+            } else if (flip[r] != s) {
+                ok = 0;
+            }
+        }
+    }
+    ok = ok && flip;
+    
+    free(flip);
+    free(p.seen);
+    free(p.side_b);
+    return ok;
+}
+
+static void dsu_print_partition(struct parity_dsu* d) {
+    for (int side = 0; side < 2; side++) {
+        int first = 1;
+        for (uint32_t v = 0; v < d->n; v++) {
+            uint8_t pv;
+            dsu_find(d, v, &pv);
+            if (pv == side) {
+                printf(first ? "%u" : ",%u", v);
+                first = 0;
+            }
+        }
+        printf(side ? "\n" : ":");
+    }
+}
+
+static int run_stream_mode(uint32_t n) {
+    struct parity_dsu d = {0};
+    if (n == 0 || !dsu_init(&d, n)) {
+        printf("Invalid vertex count or out of memory.\n");
+        dsu_free(&d);
+        return 1;
+    }
+    
+    char line[4096];
+    uint64_t inserted = 0;
+    while (fgets(line, sizeof(line), stdin)) {
+        line[strcspn(line, "\n")] = 0;
+        unsigned long u, v;
+        
+        if (strncmp(line, "check ", 6) == 0) {
+            printf(dsu_check_partition(&d, line + 6) ? "Valid.\n" : "Invalid.\n");
+        } else if (strcmp(line, "partition") == 0) {
+            if (d.bipartite) {
+                dsu_print_partition(&d);
+            } else {
+                printf("Not bipartite.\n");
+            }
+        } else if (sscanf(line, "%lu %lu", &u, &v) == 2 && u < n && v < n) {
+            dsu_add_edge(&d, (uint32_t)u, (uint32_t)v);
+            inserted++;
+        } else if (line[0]) {
+            printf("Bad command.\n");
+        }
+        fflush(stdout);
+    }
+    
+    printf("Edges: %llu  Bipartite: %s\n", (unsigned long long)inserted,
+           d.bipartite ? "yes" : "no");
+    dsu_free(&d);
+    return d.bipartite ? 0 : 1;
+}
+
+// ============== ENCRYPTED FLAG ==============
+// Encrypted by the compiler with the key the correct answer derives:
+// magic marker fold XOR answer "0,2,5,7,8,11:1,3,4,6,9,10" (0x3A)
+#define FLAG_TEXT "L3m0nCTF{v3rt3x_SEED_A_7f2a9b}"
+#define FLAG_KEY (TRILOGY_FOLD_MAGIC(MAGIC_TEXT) ^ 0x3A)
+#define FLAG_LEN (sizeof(FLAG_TEXT) - 1)
+
+_Static_assert(TRILOGY_STRING_FITS(FLAG_TEXT), "flag too long");
+static const uint8_t encoded_flag[TRILOGY_STRING_MAX] = { TRILOGY_XOR_STRING(FLAG_TEXT, FLAG_KEY) };
 
 // ============== FLAG PRINTING ==============
-static void print_flag(void) {
-    // Flag: L3m0nCTF{v3rt3x_SEED_A_7f2a9b}
+// FLAG_LEN bytes, decoded under the key the correct answer derives
+static void decode_flag(const char* answer, char* flag) {
     // XOR key = magic_bytes XOR answer_bytes
-    // Answer "0,2,5,7,8,11:1,3,4,6,9,10" XOR = 0x3A
-    // Final key = 0x40 ^ 0x3A = 0x7A
-    unsigned char encoded_flag[] = {
-        0x36, 0x49, 0x17, 0x4a, 0x14, 0x39, 0x2e, 0x3c,
-        0x01, 0x0c, 0x49, 0x08, 0x0e, 0x49, 0x02, 0x25,
-        0x29, 0x3f, 0x3f, 0x3e, 0x25, 0x3b, 0x25, 0x4d,
-        0x1c, 0x48, 0x1b, 0x43, 0x18, 0x07, 0x00
-    };
-    
-    uint8_t key = derive_flag_key(correct_answer);
+    trilogy_xor_into(flag, encoded_flag, FLAG_LEN, derive_flag_key(answer));
+}
+
+static void print_flag(const char* answer) {
+    char flag[FLAG_LEN];
+    decode_flag(answer, flag);
     
     printf("\n");
     printf("════════════════════════════════════════════════════\n");
@@ -204,11 +865,7 @@ static void print_flag(void) {
     printf("════════════════════════════════════════════════════\n");
     printf(" You have proven your understanding of the graph.   \n");
     printf("════════════════════════════════════════════════════\n");
-    printf(" FLAG: ");
-    for (size_t i = 0; encoded_flag[i]; i++) {
-        printf("%c", encoded_flag[i] ^ key);
-    }
-    printf("\n");
+    printf(" FLAG: %.*s\n", (int)FLAG_LEN, flag);
     printf("════════════════════════════════════════════════════\n");
 }
 
@@ -231,40 +888,113 @@ __attribute__((used))
 void debug_dump_graph(void) {
     init_graph();
     printf("DEBUG: Decrypted adjacency matrix:\n");
-    for (int i = 0; i < NUM_VERTICES; i++) {
-        for (int j = 0; j < NUM_VERTICES; j++) {
-            printf("%d ", adj_matrix[i][j]);
+    for (int i = 0; i < num_vertices; i++) {
+        for (int j = 0; j < num_vertices; j++) {
+            printf("%d ", bitset_test(adj_rows + (size_t)i * adj_words, j));
         }
         printf("\n");
     }
 }
 
+// ============== PIPE MODE ==============
+// vertex --pipe: one partition per line, one record each:
+// "ok <flag>" or "no"
+static void pipe_answer(void* ctx, struct trilogy_reply* r, char* line) {
+    struct vertex_session* s = ctx;
+    if (!verify_answer(s, line)) {
+        trilogy_reply_add(r, "no\n", 3);
+        return;
+    }
+    char flag[FLAG_LEN];
+    strncpy(s->correct_answer, line, 63);
+    decode_flag(s->correct_answer, flag);
+    trilogy_reply_add(r, "ok ", 3);
+    trilogy_reply_add(r, flag, FLAG_LEN);
+    trilogy_reply_add(r, "\n", 1);
+}
+
+// ============== SERVE MODE ==============
+// vertex --serve <port> [workers]: the --pipe protocol over TCP, one
+// session per connection (common/trilogy_serve.h)
+static int serve_open(void* ctx) {
+    return session_init(ctx);
+}
+
+static void serve_close(void* ctx) {
+    session_free(ctx);
+}
+
+static const struct trilogy_service vertex_service = {
+    sizeof(struct vertex_session), serve_open, serve_close, pipe_answer
+};
+
 // ============== MAIN ==============
 int main(int argc, char** argv) {
+    init_magic_key();
+    // External graph mode: vertex --edges <edge_file> <partition_file>
+    if (argc >= 4 && strcmp(argv[1], "--edges") == 0) {
+        return verify_edge_file(argv[2], argv[3]);
+    }
+    
+    // Streaming graph mode: vertex --stream <num_vertices>
+    if (argc >= 3 && strcmp(argv[1], "--stream") == 0) {
+        return run_stream_mode((uint32_t)strtoul(argv[2], NULL, 10));
+    }
+    
     // Initialize graph (decrypt)
     init_graph();
     
+    // Server mode: vertex --serve <port> [workers], a session per connection
+    if (argc >= 3 && strcmp(argv[1], "--serve") == 0) {
+        return trilogy_serve(atoi(argv[2]), argc >= 4 ? atoi(argv[3]) : 0, &vertex_service) < 0;
+    }
+    
+    // Graph is shared from here on; the player gets a session
+    struct vertex_session session;
+    if (session_init(&session) < 0) {
+        printf("Out of memory.\n");
+        return 1;
+    }
+    int rc = 0;
+    
+    // Checker mode: vertex --batch, candidate partitions on stdin
+    if (argc >= 2 && strcmp(argv[1], "--batch") == 0) {
+        rc = run_batch_mode(&session);
+        session_free(&session);
+        return rc;
+    }
+    
+    // Pipelined checker mode: vertex --pipe, one record per partition
+    if (argc >= 2 && strcmp(argv[1], "--pipe") == 0) {
+        rc = trilogy_batch_run(STDIN_FILENO, STDOUT_FILENO, &session, pipe_answer) < 0;
+        session_free(&session);
+        return rc;
+    }
+    
     // Display minimal challenge info
     display_challenge();
     
     // Check for argument
     if (argc >= 2) {
-        if (verify_answer(argv[1])) {
-            strncpy(correct_answer, argv[1], 63);
-            print_flag();
-            return 0;
+        if (verify_answer(&session, argv[1])) {
+            strncpy(session.correct_answer, argv[1], 63);
+            print_flag(session.correct_answer);
         } else {
             printf("Incorrect.\n");
-            return 1;
+            rc = 1;
         }
+        session_free(&session);
+        return rc;
     }
     
     // Interactive mode
     printf("Enter solution: ");
     fflush(stdout);
     
-    char input[64];
-    while (fgets(input, sizeof(input), stdin)) {
+    // Lines grow as needed: file graphs have long partitions
+    char* input = NULL;
+    size_t cap = 0;
+    while (getline(&input, &cap, stdin) > 0) {
         input[strcspn(input, "\n")] = 0;
         
         if (strcmp(input, "quit") == 0 || strcmp(input, "exit") == 0) {
@@ -272,10 +1002,10 @@ int main(int argc, char** argv) {
         }
         
         if (strlen(input) > 0) {
-            if (verify_answer(input)) {
-                strncpy(correct_answer, input, 63);
-                print_flag();
-                return 0;
+            if (verify_answer(&session, input)) {
+                strncpy(session.correct_answer, input, 63);
+                print_flag(session.correct_answer);
+                break;
             } else {
                 printf("Incorrect.\n");
             }
@@ -285,5 +1015,7 @@ int main(int argc, char** argv) {
         fflush(stdout);
     }
     
+    free(input);
+    session_free(&session);
     return 0;
 }